@@ -24,6 +24,7 @@
 #include <cmath>
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include "quark.h"
 
 #ifdef _WIN32
@@ -123,7 +124,7 @@ void example6(){
 }
 
 
-//	Build huge vector by appending repeatedly.
+//	Build huge vector by appending repeatedly. Each + is O(log n) and shares the nodes of both vectors.
 void example7(){
 	const steady::vector<int> a{ 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
 	const auto b = a + a + a + a + a + a + a + a + a + a;
@@ -196,13 +197,16 @@ image make_image(int width, int height){
 
 
 //	There is no way to trip-up caller because image is a copy.
+//	Uses a transient to make all the edits in place, then gets a persistent vector back.
 image worker8(image img) {
-	const size_t count = std::min<size_t>(300, img._pixels.size());
+	steady::vector<pixel>::transient pixels(img._pixels);
+	const size_t count = std::min<size_t>(300, pixels.size());
 	for(size_t i = 0 ; i < count ; i++){
-		auto pixel = img._pixels[i];
+		auto pixel = pixels[i];
 		pixel._red = 1.0f - pixel._red;
-		img._pixels = img._pixels.store(i, pixel);
+		pixels.store(i, pixel);
 	}
+	img._pixels = pixels.persistent();
 	return img;
 }
 
@@ -286,6 +290,154 @@ void example9(){
 
 
 
+/////////////////		Reference counting benchmark
+
+
+/*
+	Each thread copies a vector, stores one value in the copy and releases it, over and over. Path copying
+	retains and releases all the children of the copied inodes.
+
+	own_vectors == true: each thread works on a vector it made itself.
+	own_vectors == false: all threads work on the same vector, made by the main thread. biased_thread doesn't
+	help here: every thread uses the atomic count of the shared nodes.
+
+	Returns the total milliseconds.
+*/
+template <class RC>
+double bench_copy_destroy(int thread_count, bool own_vectors, int iterations){
+	const steady::vector<int, RC> shared(std::vector<int>(10000, 1));
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> threads;
+	for(int t = 0 ; t < thread_count ; t++){
+		threads.push_back(std::thread([&, t](){
+			const auto a = own_vectors ? steady::vector<int, RC>(std::vector<int>(10000, t)) : shared;
+			for(int i = 0 ; i < iterations ; i++){
+				auto b = a;
+				b = b.store((i * 97) % b.size(), i);
+			}
+		}));
+	}
+	for(auto& t: threads){
+		t.join();
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void bench_rc_policies(){
+	QUARK_SCOPED_TRACE(__FUNCTION__);
+
+	//	Threads beyond the number of cores only take turns: the locked instructions then cost no more than on one core.
+	QUARK_TRACE_SS("cores: " << std::thread::hardware_concurrency());
+
+	const int iterations = 20000;
+	for(int thread_count: { 1, 2, 4, 8 }){
+		for(bool own_vectors: { true, false }){
+			QUARK_TRACE_SS(
+				"threads: " << thread_count << (own_vectors ? ", own vectors" : ", shared vector")
+				<< "\tmulti_thread: " << bench_copy_destroy<steady::multi_thread>(thread_count, own_vectors, iterations) << " ms"
+				<< "\tbiased_thread: " << bench_copy_destroy<steady::biased_thread>(thread_count, own_vectors, iterations) << " ms"
+			);
+		}
+	}
+}
+
+
+
+
+/////////////////		Trivially copyable fast paths benchmark
+
+
+template <class F>
+double time_ms(F f){
+	const auto start = std::chrono::high_resolution_clock::now();
+	f();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/*
+	Copies and destructs leaf node sized blocks of values using both value_ops specializations - value by value
+	and memcpy() - then times store(), which copies a leaf node, and to_vec().
+*/
+template <class T>
+void bench_value_ops(const char* name, const T& value){
+	using steady::internals::value_ops;
+
+	const int iterations = 1000000;
+	const size_t count = steady::BRANCHING_FACTOR;
+	const std::vector<T> source(count, value);
+	std::vector<typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type> storage(count);
+	T* dest = reinterpret_cast<T*>(storage.data());
+
+	const auto generic_ms = time_ms([&](){
+		for(int i = 0 ; i < iterations ; i++){
+			value_ops<T, false>::construct_copies(dest, source.data(), count);
+			value_ops<T, false>::destroy(dest, count);
+		}
+	});
+	const auto trivial_ms = time_ms([&](){
+		for(int i = 0 ; i < iterations ; i++){
+			value_ops<T, true>::construct_copies(dest, source.data(), count);
+			value_ops<T, true>::destroy(dest, count);
+		}
+	});
+
+	const steady::vector<T> a(std::vector<T>(100000, value));
+	const auto store_ms = time_ms([&](){
+		for(int i = 0 ; i < 100000 ; i++){
+			const auto b = a.store((static_cast<size_t>(i) * 7919) % a.size(), value);
+		}
+	});
+	const auto to_vec_ms = time_ms([&](){
+		for(int i = 0 ; i < 100 ; i++){
+			const auto v = a.to_vec();
+		}
+	});
+
+	QUARK_TRACE_SS(name
+		<< "\tcopy 1M blocks, value by value: " << generic_ms << " ms, memcpy(): " << trivial_ms << " ms"
+		<< "\t100k store(): " << store_ms << " ms\t100 to_vec() of 100k values: " << to_vec_ms << " ms"
+	);
+}
+
+//	Compares equal leaf node sized blocks of ints value by value and with memcmp().
+void bench_value_compare(){
+	using steady::internals::value_compare;
+
+	const int iterations = 1000000;
+	const size_t count = steady::BRANCHING_FACTOR;
+	const std::vector<int> a(count, 7);
+	const std::vector<int> b(count, 7);
+
+	size_t total = 0;
+	const auto generic_ms = time_ms([&](){
+		for(int i = 0 ; i < iterations ; i++){
+			total += value_compare<int, false>::mismatch(a.data(), b.data(), count);
+		}
+	});
+	const auto bitwise_ms = time_ms([&](){
+		for(int i = 0 ; i < iterations ; i++){
+			total += value_compare<int, true>::mismatch(a.data(), b.data(), count);
+		}
+	});
+	assert(total == count * iterations * 2);
+
+	QUARK_TRACE_SS("int\tcompare 1M blocks, value by value: " << generic_ms << " ms, memcmp(): " << bitwise_ms << " ms");
+}
+
+void bench_trivially_copyable(){
+	QUARK_SCOPED_TRACE(__FUNCTION__);
+
+	bench_value_ops<int>("int", 3);
+	bench_value_ops<float>("float", 3.0f);
+	bench_value_ops<pixel>("pixel", pixel(0.5f, 0.5f, 0.0f, 1.0f));
+	bench_value_compare();
+}
+
+
+
 void examples(){
 	example1();
 	example2();
@@ -296,6 +448,12 @@ void examples(){
 	example7();
 	example8();
 //	example9();
+
+	//	Timings with asserts on say little.
+#if !QUARK_ASSERT_ON
+	bench_rc_policies();
+	bench_trivially_copyable();
+#endif
 }
 
 int main(int argc, const char * argv[]){
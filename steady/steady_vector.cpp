@@ -20,6 +20,10 @@
 
 #include <algorithm>
 #include <memory>
+#include <thread>
+#include <numeric>
+#include <limits>
+#include <type_traits>
 #include "quark.h"
 
 
@@ -108,12 +112,12 @@ QUARK_UNIT_TEST("std::vector<>", "auto convertion from initializer list", "", ""
 	Fixture class that you put on the stack in your unit tests.
 	It makes sure the total count of leaf_node<T> and inode<T> are as expected - no leakage.
 */
-template <class T>
+template <class T, class RC = multi_thread>
 struct test_fixture {
 	test_fixture() :
 		_scoped_tracer("test_fixture"),
-		_inode_count(inode<T>::_debug_count),
-		_leaf_count(leaf_node<T>::_debug_count)
+		_inode_count(inode<T, RC>::_debug_count),
+		_leaf_count(leaf_node<T, RC>::_debug_count)
 	{
 		TRACE_SS("inode count: " << _inode_count << " " << "Leaf node count: " << _leaf_count);
 	}
@@ -123,8 +127,8 @@ struct test_fixture {
 	*/
 	test_fixture(int inode_expected_count, int leaf_expected_count) :
 		_scoped_tracer("test_fixture"),
-		_inode_count(inode<T>::_debug_count),
-		_leaf_count(leaf_node<T>::_debug_count),
+		_inode_count(inode<T, RC>::_debug_count),
+		_leaf_count(leaf_node<T, RC>::_debug_count),
 
 		_inode_expected_count(inode_expected_count),
 		_leaf_expected_count(leaf_expected_count)
@@ -133,8 +137,8 @@ struct test_fixture {
 	}
 
 	~test_fixture(){
-		int inode_count = inode<T>::_debug_count;
-		int leaf_count = leaf_node<T>::_debug_count;
+		int inode_count = inode<T, RC>::_debug_count;
+		int leaf_count = leaf_node<T, RC>::_debug_count;
 
 		TRACE_SS("inode count: " << inode_count << " " << "Leaf node count: " << leaf_count);
 
@@ -167,14 +171,14 @@ QUARK_UNIT_TEST("", "test_fixture()", "1 inode, 2 leaf nodes", "correct state (a
 	test_fixture<int> test;
 
 	std::unique_ptr<inode<int>> a;
-	std::unique_ptr<leaf_node<int>> b;
-	std::unique_ptr<leaf_node<int>> c;
+	node_ref<int> b;
+	node_ref<int> c;
 	{
 		test_fixture<int> test(1, 2);
 
-		a.reset(new inode<int>({}));
-		b.reset(new leaf_node<int>());
-		c.reset(new leaf_node<int>());
+		a.reset(inode<int>::make(inode<int>::children_t{}));
+		b = node_ref<int>(leaf_node<int>::make(BRANCHING_FACTOR));
+		c = node_ref<int>(leaf_node<int>::make(1));
 
 		VERIFY(test._inode_count == 0);
 		VERIFY(test._leaf_count == 0);
@@ -222,18 +226,25 @@ std::array<int, BRANCHING_FACTOR> generate_leaves(int start, int count){
 	return result;
 }
 
+//	Copies the constructed values of _leaf_, the rest are 0.
+std::array<int, BRANCHING_FACTOR> get_leaf_values(const leaf_node<int>* leaf){
+	std::array<int, BRANCHING_FACTOR> result{};
+	std::copy(leaf->get_values(), leaf->get_values() + leaf->_used, result.begin());
+	return result;
+}
+
 
 /*
-	Construct a vector that uses 1 leaf node.
+	Construct a vector that uses 1 leaf node, as tail.
 
-	leaf_node
+	tail: leaf_node
 		value 0
 */
 vector<int> make_manual_vector1(){
 	test_fixture<int> f(0, 1);
 
 	node_ref<int> leaf = make_leaf_node<int>({ 7 });
-	return vector<int>(leaf, 1, LEAF_NODE_SHIFT);
+	return vector<int>(node_ref<int>(), EMPTY_TREE_SHIFT, 0, leaf, 1, 0);
 }
 
 QUARK_UNIT_TEST("", "make_manual_vector1()", "", "correct nodes"){
@@ -241,19 +252,17 @@ QUARK_UNIT_TEST("", "make_manual_vector1()", "", "correct nodes"){
 
 	const auto a = make_manual_vector1();
 	VERIFY(a.size() == 1);
-	VERIFY(a.get_root().get_type() == node_type::leaf_node);
-	VERIFY(a.get_root().get_leaf_node()->_rc == 1);
-	VERIFY(a.get_root().get_leaf_node()->_values[0] == 7);
-	for(int i = 1 ; i < BRANCHING_FACTOR ; i++){
-		VERIFY(a.get_root().get_leaf_node()->_values[i] == 0);
-	}
+	VERIFY(a.get_root().get_type() == node_type::null_node);
+	VERIFY(a.get_tail().get_type() == node_type::leaf_node);
+	VERIFY(a.get_tail().get_leaf_node()->_rc == 1);
+	VERIFY(get_leaf_values(a.get_tail().get_leaf_node()) == generate_leaves(7, 1));
 }
 
 
 /*
 	Construct a vector that uses 1 leaf node and two values.
 
-	leaf_node
+	tail: leaf_node
 		value 0
 		value 1
 */
@@ -261,40 +270,34 @@ vector<int> make_manual_vector2(){
 	test_fixture<int> f(0, 1);
 
 	node_ref<int> leaf = make_leaf_node<int>({	7, 8	});
-	return vector<int>(leaf, 2, LEAF_NODE_SHIFT);
+	return vector<int>(node_ref<int>(), EMPTY_TREE_SHIFT, 0, leaf, 2, 0);
 }
 
 QUARK_UNIT_TEST("", "make_manual_vector2()", "", "correct nodes"){
 	test_fixture<int> f;
 	const auto a = make_manual_vector2();
 	VERIFY(a.size() == 2);
-	VERIFY(a.get_root().get_type() == node_type::leaf_node);
-	VERIFY(a.get_root().get_leaf_node()->_rc == 1);
-	VERIFY(a.get_root().get_leaf_node()->_values[0] == 7);
-	VERIFY(a.get_root().get_leaf_node()->_values[1] == 8);
-	VERIFY(a.get_root().get_leaf_node()->_values[2] == 0);
-	VERIFY(a.get_root().get_leaf_node()->_values[3] == 0);
+	VERIFY(a.get_tail().get_type() == node_type::leaf_node);
+	VERIFY(a.get_tail().get_leaf_node()->_rc == 1);
+	VERIFY(get_leaf_values(a.get_tail().get_leaf_node()) == generate_leaves(7, 2));
 }
 
 
 /*
-	Construct a vector that uses 1 inode and 2 leaf nodes.
+	Construct a vector that uses 2 leaf nodes: one full leaf node in the tree and 1 value in the tail.
 
-	inode
-		leaf_node
-			value 0
-			value 1
-			... full
-		leaf_node
-			value x
+	leaf_node
+		value 0
+		value 1
+		... full
+	tail: leaf_node
+		value x
 */
 vector<int> make_manual_vector_branchfactor_plus_1(){
-	test_fixture<int> f(1, 2);
+	test_fixture<int> f(0, 2);
 	node_ref<int> leaf0 = make_leaf_node<int>(generate_leaves(7, BRANCHING_FACTOR));
 	node_ref<int> leaf1 = make_leaf_node<int>(generate_leaves(7 + BRANCHING_FACTOR, 1));
-	std::vector<node_ref<int>> leafs = { leaf0, leaf1 };
-	node_ref<int> inode = make_inode_from_vector(leafs);
-	return vector<int>(inode, BRANCHING_FACTOR + 1, vector_size_to_shift(BRANCHING_FACTOR + 1));
+	return vector<int>(leaf0, LEAF_NODE_SHIFT, BRANCHING_FACTOR, leaf1, BRANCHING_FACTOR + 1, 0);
 }
 
 QUARK_UNIT_TEST("", "make_manual_vector_branchfactor_plus_1()", "", "correct nodes"){
@@ -303,44 +306,39 @@ QUARK_UNIT_TEST("", "make_manual_vector_branchfactor_plus_1()", "", "correct nod
 	const auto a = make_manual_vector_branchfactor_plus_1();
 	VERIFY(a.size() == BRANCHING_FACTOR + 1);
 
-	VERIFY(a.get_root().get_type() == node_type::inode);
-	VERIFY(a.get_root().get_inode()->_rc == 1);
-	VERIFY(a.get_root().get_inode()->count_children() == 2);
-	VERIFY(a.get_root().get_inode()->get_child(0).get_type() == node_type::leaf_node);
-	VERIFY(a.get_root().get_inode()->get_child(1).get_type() == node_type::leaf_node);
+	VERIFY(a.get_root().get_type() == node_type::leaf_node);
+	VERIFY(a.get_tail().get_type() == node_type::leaf_node);
 
-	const auto leaf0 = a.get_root().get_inode()->get_child_as_leaf_node(0);
+	const auto leaf0 = a.get_root().get_leaf_node();
 	VERIFY(leaf0->_rc == 1);
-	VERIFY(leaf0->_values == generate_leaves(7 + BRANCHING_FACTOR * 0, BRANCHING_FACTOR));
+	VERIFY(get_leaf_values(leaf0) == generate_leaves(7 + BRANCHING_FACTOR * 0, BRANCHING_FACTOR));
 
-	const auto leaf1 = a.get_root().get_inode()->get_child_as_leaf_node(1);
+	const auto leaf1 = a.get_tail().get_leaf_node();
 	VERIFY(leaf1->_rc == 1);
-	VERIFY(leaf1->_values == generate_leaves(7 + BRANCHING_FACTOR * 1, 1));
+	VERIFY(get_leaf_values(leaf1) == generate_leaves(7 + BRANCHING_FACTOR * 1, 1));
 }
 
 /*
-	Construct a vector using 2 levels of inodes.
+	Construct a vector using 1 level of inodes plus tail.
 
 	inode
-		inode
-			leaf_node 0
-				value 0
-				value 1
-				... full
-			leaf node 1
-				value 0
-				value 1
-				... full
-			leaf node 2
-				value 0
-				value 1
-				... full
+		leaf_node 0
+			value 0
+			value 1
+			... full
+		leaf node 1
+			value 0
+			value 1
+			... full
+		leaf node 2
+			value 0
+			value 1
 			... full
-		inode
-			leaf_node
+		... full
+	tail: leaf_node
 */
 vector<int> make_manual_vector_branchfactor_square_plus_1(){
-	test_fixture<int> f(3, BRANCHING_FACTOR + 1);
+	test_fixture<int> f(1, BRANCHING_FACTOR + 1);
 
 	std::vector<node_ref<int>> leaves;
 	for(int i = 0 ; i < BRANCHING_FACTOR ; i++){
@@ -350,11 +348,9 @@ vector<int> make_manual_vector_branchfactor_square_plus_1(){
 
 	node_ref<int> extraLeaf = make_leaf_node<int>(generate_leaves(1000 + BRANCHING_FACTOR * BRANCHING_FACTOR + 0, 1));
 
-	node_ref<int> inodeA = make_inode_from_vector<int>(leaves);
-	node_ref<int> inodeB = make_inode_from_vector<int>({ extraLeaf });
-	node_ref<int> rootInode = make_inode_from_vector<int>({ inodeA, inodeB });
+	node_ref<int> rootInode = make_inode_from_vector<int>(leaves);
 	const size_t size = BRANCHING_FACTOR * BRANCHING_FACTOR + 1;
-	return vector<int>(rootInode, size, vector_size_to_shift(size));
+	return vector<int>(rootInode, LOWEST_LEVEL_INODE_SHIFT, BRANCHING_FACTOR * BRANCHING_FACTOR, extraLeaf, size, 0);
 }
 
 QUARK_UNIT_TEST("", "make_manual_vector_branchfactor_square_plus_1()", "", "correct nodes"){
@@ -366,29 +362,62 @@ QUARK_UNIT_TEST("", "make_manual_vector_branchfactor_square_plus_1()", "", "corr
 	node_ref<int> rootINode = a.get_root();
 	VERIFY(rootINode.get_type() == node_type::inode);
 	VERIFY(rootINode.get_inode()->_rc == 2);
-	VERIFY(rootINode.get_inode()->count_children() == 2);
-	VERIFY(rootINode.get_inode()->get_child(0).get_type() == node_type::inode);
-	VERIFY(rootINode.get_inode()->get_child(1).get_type() == node_type::inode);
-
-	node_ref<int> inodeA = rootINode.get_inode()->get_child(0);
-		VERIFY(inodeA.get_type() == node_type::inode);
-		VERIFY(inodeA.get_inode()->_rc == 2);
-		VERIFY(inodeA.get_inode()->count_children() == BRANCHING_FACTOR);
-		for(int i = 0 ; i < BRANCHING_FACTOR ; i++){
-			const auto leafNode = inodeA.get_inode()->get_child_as_leaf_node(i);
-			VERIFY(leafNode->_rc == 1);
-			VERIFY(leafNode->_values == generate_leaves(1000 + BRANCHING_FACTOR * i, BRANCHING_FACTOR));
-		}
+	VERIFY(rootINode.get_inode()->count_children() == BRANCHING_FACTOR);
+	for(int i = 0 ; i < BRANCHING_FACTOR ; i++){
+		const auto leafNode = rootINode.get_inode()->get_child_as_leaf_node(i);
+		VERIFY(leafNode->_rc == 1);
+		VERIFY(get_leaf_values(leafNode) == generate_leaves(1000 + BRANCHING_FACTOR * i, BRANCHING_FACTOR));
+	}
+
+	const auto leaf4 = a.get_tail().get_leaf_node();
+	VERIFY(leaf4->_rc == 1);
+	VERIFY(get_leaf_values(leaf4) == generate_leaves(1000 + BRANCHING_FACTOR * BRANCHING_FACTOR + 0, 1));
+}
+
+
+////////////////////////////////////////////		node_ref<T>
 
-	node_ref<int> inodeB = rootINode.get_inode()->get_child(1);
-		VERIFY(inodeB.get_type() == node_type::inode);
-		VERIFY(inodeB.get_inode()->_rc == 2);
-		VERIFY(inodeB.get_inode()->count_children() == 1);
-		VERIFY(inodeB.get_inode()->get_child(0).get_type() == node_type::leaf_node);
 
-		const auto leaf4 = inodeB.get_inode()->get_child_as_leaf_node(0);
-		VERIFY(leaf4->_rc == 1);
-		VERIFY(leaf4->_values == generate_leaves(1000 + BRANCHING_FACTOR * BRANCHING_FACTOR + 0, 1));
+QUARK_UNIT_TEST("node_ref", "node_ref()", "", "one pointer big"){
+	VERIFY(sizeof(node_ref<int>) == sizeof(void*));
+	VERIFY(sizeof(inode<int>::children_t) == BRANCHING_FACTOR * sizeof(void*));
+}
+
+QUARK_UNIT_TEST("node_ref", "get_type()", "null, inode, leaf node", "correct type and node"){
+	test_fixture<int> f;
+
+	const node_ref<int> a;
+	VERIFY(a.get_type() == node_type::null_node);
+
+	const auto leaf = leaf_node<int>::make(BRANCHING_FACTOR);
+	const node_ref<int> b(leaf);
+	VERIFY(b.get_type() == node_type::leaf_node);
+	VERIFY(b.get_leaf_node() == leaf);
+	VERIFY(leaf->_rc == 1);
+
+	const auto node = inode<int>::make(inode<int>::children_t{ { b } });
+	const node_ref<int> c(node);
+	VERIFY(c.get_type() == node_type::inode);
+	VERIFY(c.get_inode() == node);
+	VERIFY(c.get_inode()->get_child(0).get_leaf_node() == leaf);
+	VERIFY(leaf->_rc == 2);
+}
+
+QUARK_UNIT_TEST("node_ref", "node_ref(node_ref&& ref), operator=(node_ref&& rhs)", "leaf node", "takes over the reference"){
+	test_fixture<int> f;
+
+	const auto leaf = leaf_node<int>::make(BRANCHING_FACTOR);
+	node_ref<int> a(leaf);
+	node_ref<int> b(std::move(a));
+	VERIFY(a.get_type() == node_type::null_node);
+	VERIFY(b.get_leaf_node() == leaf);
+	VERIFY(leaf->_rc == 1);
+
+	node_ref<int> c;
+	c = std::move(b);
+	VERIFY(b.get_type() == node_type::null_node);
+	VERIFY(c.get_leaf_node() == leaf);
+	VERIFY(leaf->_rc == 1);
 }
 
 
@@ -520,12 +549,13 @@ vector<int> push_back_n(int count, int value0){
 	return a;
 }
 
-void test_values(const vector<int>& vec, int value0){
-	test_fixture<int> f;
+template <class RC>
+void test_values(const vector<int, RC>& vec, int value0){
+	test_fixture<int, RC> f;
 
-	for(int i = 0 ; i < vec.size() ; i++){
+	for(std::size_t i = 0 ; i < vec.size() ; i++){
 		const auto value = vec[i];
-		const auto expected = value0 + i;
+		const auto expected = value0 + static_cast<int>(i);
 		VERIFY(value == expected);
 	}
 }
@@ -601,6 +631,55 @@ QUARK_UNIT_TEST("vector", "push_back()", "3-levels of inodes + add leaf-node to
 }
 
 
+QUARK_UNIT_TEST("vector", "push_back()", "value into tail", "tail leaf node is shared, not copied"){
+	test_fixture<int> f;
+
+	//	The tail has room for 4 values.
+	const vector<int> a{ 10, 11, 12 };
+	const auto b = a.push_back(13);
+
+	VERIFY(a.get_tail().get_leaf_node() == b.get_tail().get_leaf_node());
+	VERIFY(a.to_vec() == (std::vector<int>{ 10, 11, 12 }));
+	VERIFY(b.to_vec() == (std::vector<int>{ 10, 11, 12, 13 }));
+}
+
+QUARK_UNIT_TEST("vector", "push_back()", "two values onto same vector", "second push_back() copies tail"){
+	test_fixture<int> f;
+	const vector<int> a{ 10, 11 };
+	const auto b = a.push_back(12);
+	const auto c = a.push_back(13);
+
+	VERIFY(b.get_tail().get_leaf_node() != c.get_tail().get_leaf_node());
+	VERIFY(a.to_vec() == (std::vector<int>{ 10, 11 }));
+	VERIFY(b.to_vec() == (std::vector<int>{ 10, 11, 12 }));
+	VERIFY(c.to_vec() == (std::vector<int>{ 10, 11, 13 }));
+}
+
+QUARK_UNIT_TEST("vector", "push_back()", "Branchfactor^2 + 1 values", "one leaf node per Branchfactor values"){
+	test_fixture<int> f;
+	const auto count = BRANCHING_FACTOR * BRANCHING_FACTOR + 1;
+	const auto inode_count = get_inode_count<int>();
+	const auto leaf_count = get_leaf_count<int>();
+
+	vector<int> a = push_back_n(count, 1000);
+	VERIFY(get_inode_count<int>() - inode_count == 1);
+	VERIFY(get_leaf_count<int>() - leaf_count == BRANCHING_FACTOR + 1);
+	test_values(a, 1000);
+}
+
+QUARK_UNIT_TEST("vector", "store()", "value in tail", "original unchanged"){
+	test_fixture<int> f;
+	const vector<int> a{ 10, 11, 12 };
+	const auto b = a.store(1, 21);
+
+	VERIFY(a.to_vec() == (std::vector<int>{ 10, 11, 12 }));
+	VERIFY(b.to_vec() == (std::vector<int>{ 10, 21, 12 }));
+
+	const auto c = b.push_back(13);
+	VERIFY(c.to_vec() == (std::vector<int>{ 10, 21, 12, 13 }));
+}
+
+
 ////////////////////////////////////////////		vector::push_back(const std::vector<T>& values)
 
 
@@ -626,6 +705,20 @@ QUARK_UNIT_TEST("vector", "push_back()", "1-level of inodes + add leaf-node to l
 	VERIFY(a.to_vec() == data);
 }
 
+QUARK_UNIT_TEST("vector", "push_back()", "batch onto shared tail twice", "both results correct"){
+	test_fixture<int> f;
+	const auto data = generate_numbers(100, BRANCHING_FACTOR * 3, BRANCHING_FACTOR * 3);
+	const vector<int> a{ 1, 2, 3 };
+	const auto b = a.push_back(&data[0], data.size());
+	const auto c = a.push_back(&data[0], 2);
+
+	auto expected_b = std::vector<int>{ 1, 2, 3 };
+	expected_b.insert(expected_b.end(), data.begin(), data.end());
+	VERIFY(b.to_vec() == expected_b);
+	VERIFY(c.to_vec() == (std::vector<int>{ 1, 2, 3, 100, 101 }));
+	VERIFY(a.to_vec() == (std::vector<int>{ 1, 2, 3 }));
+}
+
 
 ////////////////////////////////////////////		vector::pop_back()
 
@@ -639,6 +732,74 @@ QUARK_UNIT_TEST("vector", "pop_back()", "basic", "correct result vector"){
 	VERIFY(b.to_vec() == data2);
 }
 
+QUARK_UNIT_TEST("vector", "pop_back()", "value in tail", "shares tail, no new nodes"){
+	test_fixture<int> f;
+	const auto a = push_back_n(BRANCHING_FACTOR + 5, 1000);
+
+	test_fixture<int> f2(0, 0);
+	const auto b = a.pop_back();
+	VERIFY(b.size() == BRANCHING_FACTOR + 4);
+	VERIFY(b.get_tail().get_leaf_node() == a.get_tail().get_leaf_node());
+	test_values(b, 1000);
+}
+
+QUARK_UNIT_TEST("vector", "pop_back()", "last value in tail", "leaf node moves from tree to tail, not copied"){
+	test_fixture<int> f;
+	const auto a = make_manual_vector_branchfactor_square_plus_1();
+
+	const auto b = a.pop_back();
+	VERIFY(b.size() == BRANCHING_FACTOR * BRANCHING_FACTOR);
+	VERIFY(b.get_tail().get_leaf_node() == a.get_root().get_inode()->_children[BRANCHING_FACTOR - 1].get_leaf_node());
+	VERIFY(get_leaf_count<int>() == BRANCHING_FACTOR + 1);
+	VERIFY(get_inode_count<int>() == 2);
+	test_values(b, 1000);
+}
+
+QUARK_UNIT_TEST("vector", "pop_back()", "2-levels of inodes down to empty", "correct values all the way"){
+	test_fixture<int> f;
+	auto a = push_back_n(BRANCHING_FACTOR * BRANCHING_FACTOR * 2 + 3, 0);
+	while(a.size() > 0){
+		a = a.pop_back();
+		VERIFY(validate_tree(a.get_root(), a.get_shift(), a.get_tree_size()));
+		if(a.size() > 0){
+			VERIFY(a[a.size() - 1] == static_cast<int>(a.size()) - 1);
+		}
+	}
+	VERIFY(a.get_root().get_type() == node_type::null_node);
+	VERIFY(a.get_shift() == EMPTY_TREE_SHIFT);
+}
+
+
+////////////////////////////////////////////		vector::take()
+
+
+QUARK_UNIT_TEST("vector", "take()", "many counts", "correct values, no leaf nodes copied"){
+	test_fixture<int> f;
+	const auto a = push_back_n(5000, 0);
+	const auto leaf_count = get_leaf_count<int>();
+
+	for(const std::size_t count: { 0, 1, 31, 32, 33, 1023, 1024, 1025, 4999, 5000 }){
+		const auto b = a.take(count);
+		VERIFY(b.size() == count);
+		VERIFY(validate_tree(b.get_root(), b.get_shift(), b.get_tree_size()));
+		test_values(b, 0);
+		VERIFY(get_leaf_count<int>() == leaf_count);
+	}
+}
+
+QUARK_UNIT_TEST("vector", "take()", "1 value of Branchfactor^2 + 1", "releases all other nodes"){
+	test_fixture<int> f;
+	vector<int> b;
+	{
+		const auto a = make_manual_vector_branchfactor_square_plus_1();
+		b = a.take(1);
+	}
+	VERIFY(b.get_root().get_type() == node_type::null_node);
+	VERIFY(get_leaf_count<int>() == 1);
+	VERIFY(get_inode_count<int>() == 0);
+	test_values(b, 1000);
+}
+
 
 ////////////////////////////////////////////		vector::operator==()
 
@@ -678,6 +839,107 @@ QUARK_UNIT_TEST("vector", "operator==()", "1000 vs 1000", "false"){
 	VERIFY(!(a == b));
 }
 
+/*
+	Counts how many times values are compared, to prove that shared nodes are skipped.
+*/
+struct counted_int {
+	counted_int() = default;
+	counted_int(int value) :
+		_value(value)
+	{
+	}
+	bool operator==(const counted_int& rhs) const{
+		_compare_count++;
+		return _value == rhs._value;
+	}
+	bool operator<(const counted_int& rhs) const{
+		_compare_count++;
+		return _value < rhs._value;
+	}
+
+	int _value = 0;
+	static size_t _compare_count;
+};
+
+size_t counted_int::_compare_count = 0;
+
+QUARK_UNIT_TEST("vector", "operator==()", "two versions of 5000 values", "only compares the nodes that differ"){
+	test_fixture<counted_int> f;
+	std::vector<counted_int> data;
+	for(int i = 0 ; i < 5000 ; i++){
+		data.push_back(i);
+	}
+	const vector<counted_int> a(data);
+
+	//	b has a copy of the path to value 2500, but the same values as a.
+	const auto b = a.store(2500, 2500).store(4990, 4990);
+	const auto c = b.store(1000, -1);
+
+	counted_int::_compare_count = 0;
+	VERIFY(a == b);
+	VERIFY(counted_int::_compare_count <= BRANCHING_FACTOR * 2);
+
+	counted_int::_compare_count = 0;
+	VERIFY(a != c);
+	VERIFY(counted_int::_compare_count <= BRANCHING_FACTOR * 3);
+}
+
+
+////////////////////////////////////////////		vector::operator<()
+
+
+QUARK_UNIT_TEST("vector", "operator<()", "small vectors", "lexicographic order"){
+	test_fixture<int> f;
+	const vector<int> a{ 1, 2, 3 };
+	VERIFY(!(a < a));
+	VERIFY(a < (vector<int>{ 1, 2, 4 }));
+	VERIFY(a < (vector<int>{ 1, 2, 3, 0 }));
+	VERIFY((vector<int>{ 1, 2 }) < a);
+	VERIFY((vector<int>{ 0, 9, 9, 9 }) < a);
+	VERIFY(vector<int>() < a);
+	VERIFY(!(a < vector<int>()));
+	VERIFY(a > (vector<int>{ 1, 2 }) && a >= a && a <= a);
+}
+
+QUARK_UNIT_TEST("vector", "operator<()", "versions of 5000 values", "lexicographic order"){
+	test_fixture<int> f;
+	const auto a = push_back_n(5000, 0);
+	const auto b = a.store(4000, 4001);
+	const auto c = a.store(100, 99);
+	VERIFY(a < b);
+	VERIFY(!(b < a));
+	VERIFY(c < a);
+	VERIFY(a < a.push_back(0));
+	VERIFY(a.pop_back() < a);
+	VERIFY(a.take(3000) < a.drop_front(1));
+}
+
+QUARK_UNIT_TEST("vector", "operator<()", "NaN, where == and < disagree", "same as std::lexicographical_compare()"){
+	test_fixture<double> f;
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	const std::vector<double> a{ 1.0, nan, 1.0 };
+	const std::vector<double> b{ 1.0, nan, 2.0 };
+
+	VERIFY((vector<double>(a) < vector<double>(b)) == std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end()));
+	VERIFY((vector<double>(b) < vector<double>(a)) == std::lexicographical_compare(b.begin(), b.end(), a.begin(), a.end()));
+	VERIFY(vector<double>(a) < vector<double>(b));
+}
+
+//	Only has operator<().
+struct less_only {
+	bool operator<(const less_only& other) const { return _value < other._value; }
+	int _value;
+};
+
+QUARK_UNIT_TEST("vector", "operator<()", "T without operator==()", "lexicographic order"){
+	test_fixture<less_only> f;
+	const vector<less_only> a{ less_only{ 1 }, less_only{ 2 } };
+	const vector<less_only> b{ less_only{ 1 }, less_only{ 3 } };
+	VERIFY(a < b);
+	VERIFY(!(b < a));
+	VERIFY(!(a < a));
+}
+
 
 ////////////////////////////////////////////		vector::size()
 
@@ -719,6 +981,40 @@ QUARK_UNIT_TEST("vector", "vector(const std::vector<T>& vec)", "7 values", "read
 	VERIFY(v[6] == 9);
 }
 
+QUARK_UNIT_TEST("vector", "vector(const std::vector<T>& vec)", "1 - 40000 values", "same tree as push_back()"){
+	test_fixture<int> f;
+	for(const auto count: { 1, 31, 32, 33, 64, 65, 1024, 1025, 1056, 1057, 32768, 32769, 40000 }){
+		const auto data = generate_numbers(0, count, count);
+		const vector<int> a(data);
+
+		vector<int> b;
+		for(const auto value: data){
+			b = std::move(b).push_back(value);
+		}
+		VERIFY(a.check_invariant());
+		VERIFY(a == b);
+		VERIFY(a.get_shift() == b.get_shift());
+		VERIFY(a.get_tree_size() == b.get_tree_size());
+		VERIFY(a.to_vec() == data);
+	}
+}
+
+QUARK_UNIT_TEST("vector", "vector(const std::vector<T>& vec)", "BRANCHING_FACTOR^3 + 1 values", "only the leaf nodes and inodes of the result"){
+	test_fixture<int> f;
+	const int count = BRANCHING_FACTOR * BRANCHING_FACTOR * BRANCHING_FACTOR + 1;
+	typedef inode<int, multi_thread> inode_t;
+	typedef leaf_node<int, multi_thread> leaf_node_t;
+	const auto inode_count = inode_t::_debug_count;
+	const auto leaf_count = leaf_node_t::_debug_count;
+	{
+		const vector<int> a(generate_numbers(0, count, count));
+
+		//	BRANCHING_FACTOR^2 full leaf nodes + the tail, BRANCHING_FACTOR inodes + the root.
+		VERIFY(leaf_node_t::_debug_count == leaf_count + BRANCHING_FACTOR * BRANCHING_FACTOR + 1);
+		VERIFY(inode_t::_debug_count == inode_count + BRANCHING_FACTOR + 1);
+	}
+}
+
 
 ////////////////////////////////////////////		vector::vector(const T values[], size_t count)
 
@@ -799,12 +1095,8 @@ QUARK_UNIT_TEST("vector", "vector(const vector& rhs)", "empty", "empty"){
 
 template <class T>
 bool same_root(const vector<T>& a, const vector<T>& b){
-	if(a.get_root().get_type() == node_type::inode){
-		return a.get_root().get_inode() == b.get_root().get_inode();
-	}
-	else{
-		return a.get_root().get_leaf_node() == b.get_root().get_leaf_node();
-	}
+	return a.get_root()._ptr == b.get_root()._ptr
+		&& a.get_tail()._ptr == b.get_tail()._ptr;
 }
 
 QUARK_UNIT_TEST("vector", "vector(const vector& rhs)", "7 values", "identical, sharing root"){
@@ -848,6 +1140,80 @@ QUARK_UNIT_TEST("vector", "operator=()", "7 values", "identical, sharing root"){
 }
 
 
+////////////////////////////////////////////		vector::transient
+
+
+QUARK_UNIT_TEST("vector::transient", "push_back()", "Branchfactor^2 + 1 values", "read back all values"){
+	test_fixture<int> f;
+	const auto count = BRANCHING_FACTOR * BRANCHING_FACTOR + 1;
+
+	vector<int>::transient t;
+	for(int i = 0 ; i < count ; i++){
+		t.push_back(1000 + i);
+	}
+	VERIFY(t.size() == count);
+	VERIFY(t[count - 1] == 1000 + count - 1);
+
+	const auto a = t.persistent();
+	VERIFY(a.size() == count);
+	test_values(a, 1000);
+}
+
+QUARK_UNIT_TEST("vector::transient", "store()", "many stores to 2 leaf nodes", "copies each node once"){
+	test_fixture<int> f;
+	const auto a = push_back_n(BRANCHING_FACTOR * BRANCHING_FACTOR * 2, 1000);
+	VERIFY(a.get_shift() == BRANCHING_FACTOR_SHIFT * 2);
+
+	const auto inode_count = get_inode_count<int>();
+	const auto leaf_count = get_leaf_count<int>();
+
+	vector<int>::transient t(a);
+	for(int i = 0 ; i < BRANCHING_FACTOR * 2 ; i++){
+		t.store(i, 3000 + i);
+	}
+	const auto b = t.persistent();
+
+	//	Root inode + one inode + two leaf nodes.
+	VERIFY(get_inode_count<int>() - inode_count == 2);
+	VERIFY(get_leaf_count<int>() - leaf_count == 2);
+
+	test_values(a, 1000);
+	VERIFY(b[0] == 3000);
+	VERIFY(b[BRANCHING_FACTOR * 2 - 1] == 3000 + BRANCHING_FACTOR * 2 - 1);
+	VERIFY(b[BRANCHING_FACTOR * 2] == 1000 + BRANCHING_FACTOR * 2);
+}
+
+QUARK_UNIT_TEST("vector::transient", "persistent()", "edit after persistent()", "persistent vector unchanged"){
+	test_fixture<int> f;
+	vector<int>::transient t(vector<int>{ 1, 2, 3 });
+	t.push_back(4);
+	const auto a = t.persistent();
+
+	t.store(0, 100);
+	t.push_back(5);
+	const auto b = t.persistent();
+
+	VERIFY(a.to_vec() == (std::vector<int>{ 1, 2, 3, 4 }));
+	VERIFY(b.to_vec() == (std::vector<int>{ 100, 2, 3, 4, 5 }));
+}
+
+QUARK_UNIT_TEST("vector::transient", "pop_back()", "2-levels of inodes down to empty", "correct values all the way"){
+	test_fixture<int> f;
+	const auto count = BRANCHING_FACTOR * BRANCHING_FACTOR + 3;
+	const auto a = push_back_n(count, 1000);
+
+	vector<int>::transient t(a);
+	for(int i = count ; i > 0 ; i--){
+		VERIFY(t.size() == static_cast<std::size_t>(i));
+		VERIFY(t[i - 1] == 1000 + i - 1);
+		t.pop_back();
+	}
+	VERIFY(t.size() == 0);
+	VERIFY(t.persistent().empty());
+	test_values(a, 1000);
+}
+
+
 ////////////////////////////////////////////		operator+()
 
 
@@ -861,24 +1227,1634 @@ QUARK_UNIT_TEST("vector", "operator+()", "3 + 4 values", "7 values"){
 	VERIFY(c.to_vec() == (std::vector<int>{ 2, 3, 4, 5, 6, 7, 8 }));
 }
 
+QUARK_UNIT_TEST("vector", "operator+()", "7 + 0 values", "7 values"){
+	test_fixture<int> f;
+	const vector<int> a{ 2, 3, 4, 5, 6, 7, 8 };
 
+	VERIFY((a + vector<int>()) == a);
+	VERIFY((vector<int>() + a) == a);
+}
 
-////////////////////////////////////////////		T = std::string
+/*
+	Verifies the vector's values are value0, value0 + 1, ... and that its tree is valid, all the way down.
+*/
+void test_concat_result(const vector<int>& vec, int value0){
+	VERIFY(validate_tree(vec.get_root(), vec.get_shift(), vec.get_tree_size()));
+	VERIFY(vec.to_vec() == generate_numbers(value0, static_cast<int>(vec.size()), static_cast<int>(vec.size())));
+	test_values(vec, value0);
+}
 
+QUARK_UNIT_TEST("vector", "operator+()", "1000 + 2000 values", "read back all values"){
+	test_fixture<int> f;
+	const auto a = push_back_n(1000, 0);
+	const auto b = push_back_n(2000, 1000);
 
+	const auto c = a + b;
+	VERIFY(c.size() == 3000);
+	test_concat_result(c, 0);
 
-QUARK_UNIT_TEST("vector", "operator+()", "3 + 4 values", "7 values"){
-	using std::string;
-	test_fixture<string> f;
+	test_values(a, 0);
+	test_values(b, 1000);
+}
 
-	const steady::vector<string> a{ "one", "two", "three" };
+QUARK_UNIT_TEST("vector", "operator+()", "Branchfactor^2 * 4 + 1 values twice", "shares all but the seam"){
+	test_fixture<int> f;
+	const auto count = BRANCHING_FACTOR * BRANCHING_FACTOR * 4 + 1;
+	const auto a = push_back_n(count, 0);
+	const auto b = push_back_n(count, count);
 
-	const steady::vector<string> b{ "four", "five" };
+	const auto leaf_count = get_leaf_count<int>();
+	const auto inode_count = get_inode_count<int>();
 	const auto c = a + b;
 
-	assert(a == (steady::vector<string>{ "one", "two", "three" }));
-	assert(b == (steady::vector<string>{ "four", "five" }));
-	assert(c == (steady::vector<string>{ "one", "two", "three", "four", "five" }));
+	//	Only nodes along the seam are new. Copying would make thousands.
+	VERIFY(get_leaf_count<int>() - leaf_count <= 4);
+	VERIFY(get_inode_count<int>() - inode_count <= 8);
+	test_concat_result(c, 0);
+}
+
+/*
+	Concatenates many small vectors of odd sizes. This makes a relaxed tree with partial leaf nodes.
+*/
+vector<int> make_relaxed_vector(int piece_count, int value0){
+	vector<int> result;
+	int value = value0;
+	for(int i = 0 ; i < piece_count ; i++){
+		const auto piece_size = (i * 7) % 45 + 1;
+		result = result + vector<int>(generate_numbers(value, piece_size, piece_size));
+		value += piece_size;
+	}
+	return result;
+}
+
+QUARK_UNIT_TEST("vector", "operator+()", "many odd sized vectors", "read back all values"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(300, 0);
+	VERIFY(a.get_root().get_inode()->_sizes != nullptr);
+	test_concat_result(a, 0);
+
+	//	Relaxed + relaxed.
+	const auto b = a + make_relaxed_vector(300, static_cast<int>(a.size()));
+	test_concat_result(b, 0);
+
+	//	Regular + relaxed.
+	const auto c = push_back_n(5000, 0) + make_relaxed_vector(100, 5000);
+	test_concat_result(c, 0);
+}
+
+QUARK_UNIT_TEST("vector", "operator+()", "relaxed vector", "store(), push_back() and pop_back() work"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(200, 0);
+	const auto size = static_cast<int>(a.size());
+
+	auto b = a;
+	for(int i = 0 ; i < size ; i += 13){
+		b = b.store(i, -i);
+	}
+	for(int i = 0 ; i < size ; i++){
+		VERIFY(b[i] == (i % 13 == 0 ? -i : i));
+	}
+	VERIFY(validate_tree(b.get_root(), b.get_shift(), b.get_tree_size()));
+
+	auto c = a;
+	for(int i = 0 ; i < 1000 ; i++){
+		c = c.push_back(size + i);
+	}
+	test_concat_result(c, 0);
+
+	auto d = c;
+	while(d.size() > 100){
+		d = d.pop_back();
+	}
+	test_concat_result(d, 0);
+	test_concat_result(a, 0);
+}
+
+QUARK_UNIT_TEST("vector::transient", "pop_back()", "relaxed vector down to empty", "correct values all the way"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(100, 0);
+
+	vector<int>::transient t(a);
+	for(int i = 0 ; i < 500 ; i++){
+		t.push_back(static_cast<int>(a.size()) + i);
+		t.store(i, i);
+	}
+	const auto b = t.persistent();
+	test_concat_result(b, 0);
+
+	while(t.size() > 0){
+		t.pop_back();
+		if(t.size() > 0){
+			VERIFY(t[t.size() - 1] == static_cast<int>(t.size()) - 1);
+		}
+	}
+	test_concat_result(a, 0);
+}
+
+
+
+////////////////////////////////////////////		vector::const_iterator
+
+
+QUARK_UNIT_TEST("vector", "begin() / end()", "empty vector", "begin() == end()"){
+	test_fixture<int> f;
+	const vector<int> a;
+	VERIFY(a.begin() == a.end());
+	VERIFY(a.end() - a.begin() == 0);
+}
+
+QUARK_UNIT_TEST("vector", "begin() / end()", "range-based for", "all values in order"){
+	test_fixture<int> f;
+	const auto a = push_back_n(BRANCHING_FACTOR * BRANCHING_FACTOR + 7, 1000);
+
+	int expected = 1000;
+	for(const auto& value: a){
+		VERIFY(value == expected);
+		expected++;
+	}
+	VERIFY(expected == 1000 + static_cast<int>(a.size()));
+}
+
+QUARK_UNIT_TEST("vector", "const_iterator", "relaxed subvec", "matches to_vec()"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(100, 0).subvec(33, 1900);
+	const auto v = a.to_vec();
+
+	VERIFY(std::vector<int>(a.begin(), a.end()) == v);
+	VERIFY(std::equal(a.begin(), a.end(), v.begin()));
+
+	//	Backwards.
+	VERIFY(std::vector<int>(v.rbegin(), v.rend()) == std::vector<int>(
+		std::reverse_iterator<vector<int>::const_iterator>(a.end()),
+		std::reverse_iterator<vector<int>::const_iterator>(a.begin())
+	));
+}
+
+QUARK_UNIT_TEST("vector", "const_iterator", "random access", "<algorithm> works"){
+	test_fixture<int> f;
+	const auto a = push_back_n(5000, 0);
+
+	VERIFY(std::lower_bound(a.begin(), a.end(), 3333) - a.begin() == 3333);
+	VERIFY(std::find(a.begin(), a.end(), 4000) == a.begin() + 4000);
+	VERIFY(std::count_if(a.begin(), a.end(), [](int value){ return value % 2 == 0; }) == 2500);
+
+	auto it = a.begin() + 100;
+	VERIFY(*it == 100);
+	VERIFY(it[1000] == 1100);
+	VERIFY(*(it += 31) == 131);
+	VERIFY(*(it -= 100) == 31);
+	VERIFY(*(it--) == 31);
+	VERIFY(*it == 30);
+	VERIFY(*(2 + it) == 32);
+	VERIFY(a.end() - it == 4970);
+	VERIFY(it < a.end() && a.end() > it && it <= it && it >= it);
+}
+
+
+////////////////////////////////////////////		subvec()
+
+
+QUARK_UNIT_TEST("vector", "subvec()", "all ranges around leaf node edges", "correct values"){
+	test_fixture<int> f;
+	const int count = 5000;
+	const auto a = push_back_n(count, 0);
+	const std::vector<int> begins = { 0, 1, 31, 32, 33, 500, 1023, 1024, 4000, 4960, 4990 };
+	const std::vector<int> lengths = { 0, 1, 31, 32, 33, 100, 5000 };
+
+	for(const auto begin: begins){
+		for(const auto length: lengths){
+			const auto end = std::min(begin + length, count);
+			for(const auto trim: { false, true }){
+				const auto b = a.subvec(begin, end, trim);
+				VERIFY(b.size() == static_cast<std::size_t>(end - begin));
+				test_concat_result(b, begin);
+
+				if(b.size() > 0){
+					test_concat_result(b.push_back(end).push_back(end + 1), begin);
+					test_concat_result(b.pop_back(), begin);
+					VERIFY(b.store(0, -1)[0] == -1);
+				}
+			}
+		}
+	}
+	test_values(a, 0);
+}
+
+QUARK_UNIT_TEST("vector", "subvec()", "subvec of subvec, of relaxed vector", "correct values"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(200, 0);
+	const auto b = a.subvec(77, a.size() - 55);
+	const auto c = b.subvec(300, b.size() - 300);
+	test_concat_result(b, 77);
+	test_concat_result(c, 377);
+	test_concat_result(c.subvec(10, c.size(), true), 387);
+
+	//	Subvecs on both sides of operator+.
+	test_concat_result(a.subvec(0, 1000) + a.subvec(1000, 3000), 0);
+	test_concat_result(a.subvec(0, 1000, true) + c.subvec(623, 2000), 0);
+}
+
+QUARK_UNIT_TEST("vector", "subvec()", "Branchfactor^2 * 4 values", "shares all leaf nodes"){
+	test_fixture<int> f;
+	const auto a = push_back_n(BRANCHING_FACTOR * BRANCHING_FACTOR * 4, 0);
+
+	const auto leaf_count = get_leaf_count<int>();
+	const auto inode_count = get_inode_count<int>();
+	const auto b = a.subvec(100, 4000);
+	const auto c = a.subvec(100, 4000, true);
+	VERIFY(get_leaf_count<int>() == leaf_count);
+	VERIFY(get_inode_count<int>() - inode_count <= 6);
+	test_concat_result(b, 100);
+	test_concat_result(c, 100);
+}
+
+QUARK_UNIT_TEST("vector", "subvec()", "trim", "releases leaf nodes before begin"){
+	test_fixture<int> f;
+	const auto leaf_count = get_leaf_count<int>();
+
+	vector<int> b;
+	vector<int> c;
+	{
+		const auto a = push_back_n(BRANCHING_FACTOR * BRANCHING_FACTOR * 4, 0);
+		b = a.subvec(3000, 3100, false);
+		c = a.subvec(3000, 3100, true);
+	}
+	test_concat_result(b, 3000);
+	test_concat_result(c, 3000);
+
+	//	b still holds every leaf node up to its end. c only the 4 it uses.
+	VERIFY(get_leaf_count<int>() - leaf_count == 3100 / BRANCHING_FACTOR + 1);
+	b = vector<int>();
+	VERIFY(get_leaf_count<int>() - leaf_count == 4);
+}
+
+QUARK_UNIT_TEST("vector", "drop_front()", "sliding window of 1000 values, 100000 times", "memory stays bounded"){
+	test_fixture<int> f;
+	const int window = 1000;
+	auto a = push_back_n(window, 0);
+
+	size_t max_leaf_count = 0;
+	size_t max_inode_count = 0;
+	for(int i = window ; i < 100000 ; i++){
+		a = a.push_back(i).drop_front(1);
+		max_leaf_count = std::max(max_leaf_count, get_leaf_count<int>());
+		max_inode_count = std::max(max_inode_count, get_inode_count<int>());
+	}
+	VERIFY(a.size() == window);
+	test_concat_result(a, 100000 - window);
+
+	VERIFY(max_leaf_count <= window / BRANCHING_FACTOR + 4);
+	VERIFY(max_inode_count <= 8);
+}
+
+QUARK_UNIT_TEST("vector", "drop_front()", "many counts", "correct values"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(100, 0);
+	for(const auto count: { 0, 1, 31, 32, 33, 1023, 1024, 1025 }){
+		test_concat_result(a.drop_front(count), count);
+		test_concat_result(a.drop_front(count).drop_front(count), count * 2);
+	}
+	VERIFY(a.drop_front(a.size()).empty());
+}
+
+QUARK_UNIT_TEST("vector", "pop_back()", "trimmed subvec of relaxed vector down to empty", "correct values all the way"){
+	test_fixture<int> f;
+	auto a = make_relaxed_vector(100, 0).subvec(1000, 2000, true);
+	while(a.size() > 0){
+		a = a.pop_back();
+		if(a.size() > 0){
+			VERIFY(a[0] == 1000);
+			VERIFY(a[a.size() - 1] == 1000 + static_cast<int>(a.size()) - 1);
+		}
+	}
+}
+
+QUARK_UNIT_TEST("vector::transient", "pop_back()", "subvec down to empty", "correct values all the way"){
+	test_fixture<int> f;
+	const auto a = push_back_n(3000, 0).subvec(1000, 2000);
+
+	vector<int>::transient t(a);
+	t.store(0, 1000);
+	t.push_back(2000);
+	test_concat_result(t.persistent(), 1000);
+	while(t.size() > 0){
+		t.pop_back();
+		if(t.size() > 0){
+			VERIFY(t[0] == 1000);
+			VERIFY(t[t.size() - 1] == 1000 + static_cast<int>(t.size()) - 1);
+		}
+	}
+}
+
+
+QUARK_UNIT_TEST("vector", "operator==()", "same values, different tree shapes", "true"){
+	test_fixture<int> f;
+	const auto a = make_relaxed_vector(100, 0);
+	const auto b = push_back_n(static_cast<int>(a.size()), 0);
+	VERIFY(a == b);
+	VERIFY(b == a);
+	VERIFY(a.subvec(10, 1000) == b.subvec(10, 1000, true));
+	VERIFY(a.drop_front(10) == b.drop_front(10));
+	VERIFY(a.drop_front(10) != b.drop_front(11).push_back(0));
+}
+
+
+////////////////////////////////////////////		Leaf node capacity
+
+
+QUARK_UNIT_TEST("", "leaf_capacity()", "", "power of 2"){
+	VERIFY(leaf_capacity(0) == 1);
+	VERIFY(leaf_capacity(1) == 1);
+	VERIFY(leaf_capacity(3) == 4);
+	VERIFY(leaf_capacity(4) == 4);
+	VERIFY(leaf_capacity(5) == 8);
+	VERIFY(leaf_capacity(BRANCHING_FACTOR) == BRANCHING_FACTOR);
+	VERIFY(leaf_node<int>::block_size(BRANCHING_FACTOR) == sizeof(leaf_node<int>));
+	VERIFY(leaf_node<int>::block_size(1) == sizeof(leaf_node<int>) - (BRANCHING_FACTOR - 1) * sizeof(int));
+}
+
+QUARK_UNIT_TEST("vector", "push_back()", "small vector", "tail grows 1, 2, 4 ..."){
+	test_fixture<int> f;
+	vector<int> a;
+	for(int i = 0 ; i < BRANCHING_FACTOR ; i++){
+		a = a.push_back(i);
+		VERIFY(static_cast<size_t>(a.get_tail().get_leaf_node()->_capacity) == leaf_capacity(i + 1));
+	}
+	test_values(a, 0);
+
+	//	Vectors with a tree get full tails at once.
+	a = a.push_back(BRANCHING_FACTOR);
+	VERIFY(a.get_tail().get_leaf_node()->_capacity == BRANCHING_FACTOR);
+}
+
+QUARK_UNIT_TEST("vector", "vector(const std::vector<T>& values)", "3 values", "tail has room for 4"){
+	test_fixture<int> f;
+	const vector<int> a{ 10, 11, 12 };
+	VERIFY(a.get_tail().get_leaf_node()->_capacity == 4);
+	VERIFY(a.to_vec() == (std::vector<int>{ 10, 11, 12 }));
+}
+
+QUARK_UNIT_TEST("vector", "push_back()", "shared, full small tail", "both grow correctly"){
+	test_fixture<int> f;
+	const vector<int> a{ 10, 11, 12 };
+
+	//	Claims the last free value of a's tail.
+	const auto b = a.push_back(13);
+	VERIFY(b.get_tail()._ptr == a.get_tail()._ptr);
+
+	//	Value 3 is taken: copies.
+	const auto c = a.push_back(-13);
+	VERIFY(c.get_tail()._ptr != a.get_tail()._ptr);
+
+	//	The tail is full: copies to a leaf node twice the size.
+	const auto d = b.push_back(14);
+	VERIFY(d.get_tail().get_leaf_node()->_capacity == 8);
+
+	VERIFY(a.to_vec() == (std::vector<int>{ 10, 11, 12 }));
+	VERIFY(b.to_vec() == (std::vector<int>{ 10, 11, 12, 13 }));
+	VERIFY(c.to_vec() == (std::vector<int>{ 10, 11, 12, -13 }));
+	VERIFY(d.to_vec() == (std::vector<int>{ 10, 11, 12, 13, 14 }));
+}
+
+QUARK_UNIT_TEST("vector::transient", "push_back()", "from empty to 100 values", "tail grows, correct values"){
+	test_fixture<int> f;
+	vector<int>::transient t;
+	for(int i = 0 ; i < 100 ; i++){
+		t.push_back(i);
+	}
+	const auto a = t.persistent();
+	test_values(a, 0);
+	VERIFY(a.size() == 100);
+}
+
+
+////////////////////////////////////////////		Inline values
+
+
+struct inline_pixel {
+	bool operator==(const inline_pixel& other) const {
+		return _red == other._red && _green == other._green && _blue == other._blue && _alpha == other._alpha;
+	}
+
+	uint8_t _red;
+	uint8_t _green;
+	uint8_t _blue;
+	uint8_t _alpha;
+};
+
+inline_pixel make_pixel(int i){
+	return inline_pixel{ static_cast<uint8_t>(i), static_cast<uint8_t>(i + 1), static_cast<uint8_t>(i + 2), 255 };
+}
+
+//	Like live_value, for inline vectors.
+struct inline_live_value {
+	explicit inline_live_value(int value) : _value(value) { _live_count++; }
+	inline_live_value(const inline_live_value& other) noexcept : _value(other._value) { _live_count++; }
+	inline_live_value& operator=(const inline_live_value& other) = default;
+	~inline_live_value(){ _live_count--; }
+
+	bool operator==(const inline_live_value& other) const { return _value == other._value; }
+
+	int _value;
+	static int _live_count;
+};
+
+int inline_live_value::_live_count = 0;
+
+template <> struct inline_capacity<inline_pixel> { static const std::size_t value = 4; };
+template <> struct inline_capacity<inline_live_value> { static const std::size_t value = 3; };
+
+std::vector<inline_pixel> make_pixels(int count){
+	std::vector<inline_pixel> result;
+	for(int i = 0 ; i < count ; i++){
+		result.push_back(make_pixel(i));
+	}
+	return result;
+}
+
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "", "", "vector object holds the inline values, others are unchanged"){
+	VERIFY(vector<inline_pixel>::INLINE_CAPACITY == 4);
+	VERIFY(sizeof(vector<inline_pixel>) == sizeof(vector<int>) + 4 * sizeof(inline_pixel));
+	VERIFY(vector<int>::INLINE_CAPACITY == 0);
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "vector(), copy, operator[]", "4 values", "inline, no nodes"){
+	test_fixture<inline_pixel> f;
+	const vector<inline_pixel> a(make_pixels(4));
+	VERIFY(a.is_inline());
+	VERIFY(leaf_node<inline_pixel>::_debug_count == f._leaf_count);
+
+	const auto b = a;
+	VERIFY(b.is_inline());
+	VERIFY(b[3] == make_pixel(3));
+	VERIFY(b.to_vec() == make_pixels(4));
+	VERIFY(a == b);
+	VERIFY(leaf_node<inline_pixel>::_debug_count == f._leaf_count);
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "push_back()", "0 to 100 values", "inline up to 4 values, then tail"){
+	test_fixture<inline_pixel> f;
+	vector<inline_pixel> a;
+	for(int i = 0 ; i < 100 ; i++){
+		a = a.push_back(make_pixel(i));
+		VERIFY(a.is_inline() == (i < 4));
+		VERIFY(a[i] == make_pixel(i));
+	}
+	VERIFY(a.to_vec() == make_pixels(100));
+
+	//	Moving to a tail leaf node leaves room for the next values.
+	const auto b = vector<inline_pixel>(make_pixels(4)).push_back(make_pixel(4));
+	VERIFY(b.get_tail().get_leaf_node()->_capacity == 8);
+	VERIFY(b.to_vec() == make_pixels(5));
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "push_back(values)", "2 + 2, 2 + 40 values", "inline, then tree"){
+	test_fixture<inline_pixel> f;
+	const auto pixels = make_pixels(42);
+	const vector<inline_pixel> a(&pixels[0], 2);
+
+	const auto b = a.push_back(&pixels[2], 2);
+	VERIFY(b.is_inline());
+	VERIFY(b.to_vec() == make_pixels(4));
+
+	const auto c = a.push_back(&pixels[2], 40);
+	VERIFY(c.is_inline() == false);
+	VERIFY(c.to_vec() == pixels);
+	VERIFY(a.size() == 2);
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "store(), pop_back(), subvec()", "", "stay inline, correct values"){
+	test_fixture<inline_pixel> f;
+	const vector<inline_pixel> a(make_pixels(4));
+
+	const auto b = a.store(1, make_pixel(100));
+	VERIFY(b.is_inline());
+	VERIFY(b[1] == make_pixel(100) && b[2] == make_pixel(2));
+	VERIFY(a[1] == make_pixel(1));
+
+	const auto c = a.pop_back();
+	VERIFY(c.is_inline() && c.size() == 3 && c[2] == make_pixel(2));
+
+	const auto d = a.subvec(1, 3);
+	VERIFY(d.is_inline());
+	VERIFY(d.to_vec() == (std::vector<inline_pixel>{ make_pixel(1), make_pixel(2) }));
+	VERIFY(leaf_node<inline_pixel>::_debug_count == f._leaf_count);
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "subvec()", "3 values in middle of leaf node", "copied inline"){
+	test_fixture<inline_pixel> f;
+	const auto pixels = make_pixels(100);
+	const vector<inline_pixel> a(pixels);
+	const auto b = a.subvec(40, 43);
+	VERIFY(b.is_inline());
+	VERIFY(b.to_vec() == std::vector<inline_pixel>(&pixels[40], &pixels[43]));
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "operator+(), swap(), operator==()", "inline and tree vectors", "correct values"){
+	test_fixture<inline_pixel> f;
+	const auto pixels = make_pixels(100);
+	const vector<inline_pixel> a(&pixels[0], 3);
+	const vector<inline_pixel> b(&pixels[3], 97);
+
+	VERIFY((a + b).to_vec() == pixels);
+	VERIFY((b + a).size() == 100);
+	VERIFY((a + a).to_vec() == (std::vector<inline_pixel>{ pixels[0], pixels[1], pixels[2], pixels[0], pixels[1], pixels[2] }));
+
+	//	Same values, inline vs tail.
+	VERIFY(a == a.to_tree());
+	VERIFY(a.to_tree().is_inline() == false);
+
+	auto c = a;
+	auto d = b;
+	c.swap(d);
+	VERIFY(c == b && d == a && d.is_inline());
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>::transient", "transient(original)", "inline vector", "correct values"){
+	test_fixture<inline_pixel> f;
+	const vector<inline_pixel> a(make_pixels(3));
+	vector<inline_pixel>::transient t(a);
+	t.push_back(make_pixel(3));
+	t.store(0, make_pixel(10));
+	const auto b = t.persistent();
+	VERIFY(b.to_vec() == (std::vector<inline_pixel>{ make_pixel(10), make_pixel(1), make_pixel(2), make_pixel(3) }));
+	VERIFY(a.to_vec() == make_pixels(3));
+}
+
+QUARK_UNIT_TEST("vector<inline_live_value>", "", "copy, store, pop_back, swap, push_back past inline", "destructs all values"){
+	{
+		vector<inline_live_value> a{ inline_live_value(0), inline_live_value(1) };
+		VERIFY(a.is_inline());
+		VERIFY(inline_live_value::_live_count == 2);
+
+		auto b = a.push_back(inline_live_value(2));
+		VERIFY(inline_live_value::_live_count == 5);
+
+		const auto c = b.store(0, inline_live_value(-1)).pop_back();
+		VERIFY(c.is_inline() && c.size() == 2 && c[0]._value == -1);
+		VERIFY(inline_live_value::_live_count == 7);
+
+		a.swap(b);
+		VERIFY(a.size() == 3 && b.size() == 2);
+		VERIFY(inline_live_value::_live_count == 7);
+
+		const auto d = a.push_back(inline_live_value(3));
+		VERIFY(d.is_inline() == false && d[3]._value == 3);
+		VERIFY(inline_live_value::_live_count == 11);
+	}
+	VERIFY(inline_live_value::_live_count == 0);
+}
+
+
+
+////////////////////////////////////////////		vector_view
+
+
+QUARK_UNIT_TEST("vector_view", "vector_view()", "", "empty"){
+	const vector_view<int> view;
+	VERIFY(view.size() == 0);
+	VERIFY(view.empty());
+	VERIFY(view.begin() == view.end());
+	VERIFY(view.to_vector().empty());
+}
+
+QUARK_UNIT_TEST("vector_view", "vector_view(vec)", "temporary vector, implicit conversion", "don't compile"){
+	typedef vector_view<int> view_t;
+	typedef const vector<int>& lvalue_t;
+	typedef vector<int>&& rvalue_t;
+	VERIFY((std::is_constructible<view_t, lvalue_t>::value));
+	VERIFY((std::is_constructible<view_t, lvalue_t, size_t, size_t>::value));
+	VERIFY((!std::is_convertible<lvalue_t, view_t>::value));
+	VERIFY((!std::is_constructible<view_t, rvalue_t>::value));
+	VERIFY((!std::is_constructible<view_t, rvalue_t, size_t, size_t>::value));
+	VERIFY((!std::is_constructible<view_t, vector<int>>::value));
+}
+
+QUARK_UNIT_TEST("vector_view", "vector_view(vec)", "1000 values", "reads all values, no RC changes"){
+	test_fixture<int> f;
+	const auto a = push_back_n(1000, 0);
+	const auto root_rc = static_cast<int32_t>(a.get_root().get_inode()->_rc);
+	const auto tail_rc = static_cast<int32_t>(a.get_tail().get_leaf_node()->_rc);
+
+	const vector_view<int> view(a);
+	const auto view2 = view;
+	VERIFY(view2.size() == 1000);
+	for(size_t i = 0 ; i < view2.size() ; i++){
+		VERIFY(view2[i] == static_cast<int>(i));
+	}
+	VERIFY(std::equal(view2.begin(), view2.end(), a.begin()));
+
+	VERIFY(a.get_root().get_inode()->_rc == root_rc);
+	VERIFY(a.get_tail().get_leaf_node()->_rc == tail_rc);
+}
+
+QUARK_UNIT_TEST("vector_view", "subview()", "[100, 900) then [10, 20)", "correct values, blocks end at the view"){
+	test_fixture<int> f;
+	const auto a = push_back_n(1000, 0);
+	const auto view = vector_view<int>(a, 100, 900).subview(10, 20);
+	VERIFY(view.size() == 10);
+	VERIFY(view[0] == 110);
+	VERIFY(*(view.end() - 1) == 119);
+
+	size_t count = 0;
+	const int* values = view.get_block(0, count);
+	VERIFY(count == 10);
+	VERIFY(values[0] == 110 && values[9] == 119);
+
+	VERIFY(view.to_vector() == a.subvec(110, 120));
+}
+
+QUARK_UNIT_TEST("vector_view", "", "source reassigned and moved while the view is used", "view reads the old values"){
+	test_fixture<int> f;
+	auto a = push_back_n(1000, 0);
+	const auto copy = a;
+	const vector_view<int> view(a, 100, 900);
+	auto it = view.begin() + 10;
+
+	a = push_back_n(10, 5000);
+	VERIFY(view.size() == 800);
+	VERIFY(view[0] == 100 && view[799] == 899);
+	VERIFY(*it == 110);
+
+	//	The view now reads nodes held only by _moved_.
+	auto c = copy;
+	a = std::move(c);
+	const auto moved = std::move(a);
+	VERIFY(std::equal(view.begin(), view.end(), moved.begin() + 100));
+	VERIFY(view.subview(10, 20).to_vector() == moved.subvec(110, 120));
+}
+
+QUARK_UNIT_TEST("vector_view", "", "tree is one leaf node, then offset by subvec()", "correct values"){
+	test_fixture<int> f;
+	const auto a = push_back_n(40, 0);
+	VERIFY(a.get_shift() == LEAF_NODE_SHIFT);
+	const vector_view<int> view(a, 5, 40);
+	VERIFY(view[0] == 5 && view[34] == 39);
+	VERIFY(std::equal(view.begin(), view.end(), a.begin() + 5));
+	VERIFY(view.to_vector() == a.subvec(5, 40));
+
+	const auto b = push_back_n(1000, 0).subvec(300, 1000);
+	const vector_view<int> view2(b);
+	VERIFY(std::equal(view2.begin(), view2.end(), b.begin()));
+	VERIFY(view2.to_vector() == b);
+}
+
+QUARK_UNIT_TEST("vector_view", "", "inline vector", "reads the values inside the vector object"){
+	test_fixture<inline_pixel> f;
+	const auto pixels = make_pixels(4);
+	const vector<inline_pixel> a(pixels);
+	VERIFY(a.is_inline());
+	const vector_view<inline_pixel> view(a, 1, 4);
+	VERIFY(view.size() == 3 && view[0] == make_pixel(1));
+
+	const auto b = view.to_vector();
+	VERIFY(b.is_inline());
+	VERIFY(b.to_vec() == std::vector<inline_pixel>(pixels.begin() + 1, pixels.end()));
+}
+
+QUARK_UNIT_TEST("vector_view", "", "read by many threads", "correct sums"){
+	test_fixture<int> f;
+	const auto a = push_back_n(10000, 0);
+	const vector_view<int> view(a);
+
+	std::vector<long> sums(4, 0);
+	std::vector<std::thread> threads;
+	for(size_t t = 0 ; t < sums.size() ; t++){
+		threads.push_back(std::thread([&sums, view, t](){
+			const auto part = view.subview(t * 2500, (t + 1) * 2500);
+			sums[t] = std::accumulate(part.begin(), part.end(), 0L);
+		}));
+	}
+	for(auto& t: threads){
+		t.join();
+	}
+	VERIFY(std::accumulate(sums.begin(), sums.end(), 0L) == 10000L * 9999 / 2);
+}
+
+
+////////////////////////////////////////////		value_ops, value_compare
+
+
+QUARK_UNIT_TEST("", "value_ops<T, true>", "ints", "copies all values"){
+	const auto a = generate_leaves(100, BRANCHING_FACTOR);
+	std::array<int, BRANCHING_FACTOR> b{};
+	value_ops<int>::construct_copies(b.data(), a.data(), 10);
+	VERIFY(b == generate_leaves(100, 10));
+}
+
+QUARK_UNIT_TEST("", "value_compare<T, true>", "ints, differ at 17", "17"){
+	const auto a = generate_leaves(100, BRANCHING_FACTOR);
+	auto b = a;
+	b[17] = -1;
+	b[20] = -1;
+	VERIFY(value_compare<int>::mismatch(a.data(), b.data(), BRANCHING_FACTOR) == 17);
+	VERIFY(value_compare<int>::mismatch(a.data(), b.data(), 17) == 17);
+	VERIFY(value_compare<int>::mismatch(a.data(), b.data(), 0) == 0);
+}
+
+QUARK_UNIT_TEST("vector<float>", "operator==()", "0.0f vs -0.0f", "equal, not compared as bits"){
+	const vector<float> a{ 1.0f, 0.0f, 2.0f };
+	const vector<float> b{ 1.0f, -0.0f, 2.0f };
+	VERIFY(a == b);
+}
+
+
+////////////////////////////////////////////		diff()
+
+
+QUARK_UNIT_TEST("", "diff()", "equal vectors", "no ranges"){
+	test_fixture<int> f;
+	const auto a = push_back_n(5000, 0);
+	VERIFY(diff(a, a).empty());
+	VERIFY(diff(a, a.store(7, 7)).empty());
+	VERIFY(diff(vector<int>(), vector<int>()).empty());
+}
+
+QUARK_UNIT_TEST("", "diff()", "stores", "changed ranges in order"){
+	test_fixture<int> f;
+	const auto a = push_back_n(5000, 0);
+	const auto b = a.store(10, -1).store(11, -1).store(12, -1).store(31, -1).store(32, -1).store(4999, -1);
+
+	typedef std::vector<std::pair<size_t, size_t>> ranges_t;
+	VERIFY(diff(a, b) == (ranges_t{ { 10, 13 }, { 31, 33 }, { 4999, 5000 } }));
+	VERIFY(diff(b, a) == diff(a, b));
+}
+
+QUARK_UNIT_TEST("", "diff()", "different sizes", "extra values are the last range"){
+	test_fixture<int> f;
+	const auto a = push_back_n(1000, 0);
+
+	typedef std::vector<std::pair<size_t, size_t>> ranges_t;
+	VERIFY(diff(a, a.push_back(1)) == (ranges_t{ { 1000, 1001 } }));
+	VERIFY(diff(a, a.take(10)) == (ranges_t{ { 10, 1000 } }));
+	VERIFY(diff(a.store(999, -1), a.take(10)) == (ranges_t{ { 10, 1000 } }));
+	VERIFY(diff(a.store(9, -1), a.take(10)) == (ranges_t{ { 9, 1000 } }));
+	VERIFY(diff(a, vector<int>()) == (ranges_t{ { 0, 1000 } }));
+}
+
+QUARK_UNIT_TEST("", "diff()", "relaxed vs regular", "changed ranges in order"){
+	test_fixture<int> f;
+	const auto a = push_back_n(3000, 0);
+	const auto b = make_relaxed_vector(300, 0).take(3000).store(2000, -1);
+
+	typedef std::vector<std::pair<size_t, size_t>> ranges_t;
+	VERIFY(diff(a, b) == (ranges_t{ { 2000, 2001 } }));
+}
+
+QUARK_UNIT_TEST("", "diff()", "3 stores in 100000 values", "only compares the nodes that differ"){
+	test_fixture<counted_int> f;
+	std::vector<counted_int> data;
+	for(int i = 0 ; i < 100000 ; i++){
+		data.push_back(i);
+	}
+	const vector<counted_int> a(data);
+	const auto b = a.store(5, -1).store(50000, -1).store(99999, -1);
+
+	counted_int::_compare_count = 0;
+	VERIFY(diff(a, b).size() == 3);
+	VERIFY(counted_int::_compare_count <= BRANCHING_FACTOR * 4);
+}
+
+QUARK_UNIT_TEST("", "diff()", "push_back() that grows the root", "only compares the nodes that differ"){
+	test_fixture<counted_int> f;
+	vector<counted_int> a;
+	for(int i = 0 ; i < BRANCHING_FACTOR * BRANCHING_FACTOR + BRANCHING_FACTOR ; i++){
+		a = a.push_back(i);
+	}
+	const auto b = a.push_back(-1).store(500, -1);
+	VERIFY(b.get_shift() > a.get_shift());
+
+	counted_int::_compare_count = 0;
+	get_mismatch_step_count() = 0;
+	typedef std::vector<std::pair<size_t, size_t>> ranges_t;
+	VERIFY(diff(a, b) == (ranges_t{ { 500, 501 }, { a.size(), b.size() } }));
+	VERIFY(counted_int::_compare_count <= BRANCHING_FACTOR * 4);
+	TRACE_SS("steps: " << get_mismatch_step_count());
+	VERIFY(get_mismatch_step_count() <= BRANCHING_FACTOR * 8);
+}
+
+QUARK_UNIT_TEST("", "diff()", "drop_front() vs subvec(), 100000 values", "only compares the nodes that differ"){
+	test_fixture<counted_int> f;
+	std::vector<counted_int> data;
+	for(int i = 0 ; i < 100000 ; i++){
+		data.push_back(i);
+	}
+	const vector<counted_int> a(data);
+	const auto b = a.drop_front(40000);
+	const auto c = a.subvec(40000, 100000).store(30000, -1);
+	VERIFY(b.get_offset() != c.get_offset() || b.get_shift() != c.get_shift());
+
+	counted_int::_compare_count = 0;
+	get_mismatch_step_count() = 0;
+	typedef std::vector<std::pair<size_t, size_t>> ranges_t;
+	VERIFY(diff(b, c) == (ranges_t{ { 30000, 30001 } }));
+	VERIFY(counted_int::_compare_count <= BRANCHING_FACTOR * 4);
+	TRACE_SS("steps: " << get_mismatch_step_count());
+	VERIFY(get_mismatch_step_count() <= BRANCHING_FACTOR * 8);
+}
+
+
+////////////////////////////////////////////		node_pool
+
+
+QUARK_UNIT_TEST("", "node_pool_block_size()", "inodes and leaf nodes", "inodes of all types share one size"){
+	VERIFY(node_pool_block_size(sizeof(inode<int>)) == node_pool_block_size(sizeof(inode<std::string>)));
+	VERIFY(node_pool_block_size(sizeof(inode<int>)) == node_pool_block_size(sizeof(inode<double>)));
+	VERIFY(node_pool_block_size(sizeof(leaf_node<int>)) == node_pool_block_size(sizeof(leaf_node<float>)));
+	VERIFY(node_pool_block_size(sizeof(leaf_node<int>)) != node_pool_block_size(sizeof(leaf_node<double>)));
+	VERIFY(node_pool_block_size(1) == alignof(std::max_align_t));
+}
+
+node_pool_stats get_pool_stats(size_t node_size){
+	for(const auto& stats: get_node_pool_stats()){
+		if(stats._block_size == node_pool_block_size(node_size)){
+			return stats;
+		}
+	}
+	return node_pool_stats{ node_pool_block_size(node_size), 0, 0, 0 };
+}
+
+QUARK_UNIT_TEST("", "node_pool", "make and destroy vector 10 times", "reuses the blocks"){
+	test_fixture<int> f;
+	{
+		const auto a = push_back_n(10000, 0);
+	}
+	const auto heap_block_count = get_pool_stats(sizeof(leaf_node<int>))._heap_block_count;
+	VERIFY(heap_block_count >= 10000 / BRANCHING_FACTOR);
+
+	for(int i = 0 ; i < 10 ; i++){
+		const auto a = push_back_n(10000, 0);
+		test_values(a, 0);
+	}
+	VERIFY(get_pool_stats(sizeof(leaf_node<int>))._heap_block_count == heap_block_count);
+}
+
+QUARK_UNIT_TEST("", "node_pool", "vectors made by other threads, destroyed by this thread", "reuses the blocks"){
+	test_fixture<int> f;
+	const auto make = [](){
+		vector<int> result;
+		std::thread t([&](){ result = push_back_n(10000, 0); });
+		t.join();
+		return result;
+	};
+
+	make();
+	const auto heap_block_count = get_pool_stats(sizeof(leaf_node<int>))._heap_block_count;
+	for(int i = 0 ; i < 10 ; i++){
+		const auto a = make();
+		test_values(a, 0);
+	}
+
+	//	The other threads take back the blocks this thread frees via the depot. Allow for the blocks cached by this thread.
+	const auto stats = get_pool_stats(sizeof(leaf_node<int>));
+	VERIFY(stats._heap_block_count <= heap_block_count + NODE_POOL_MAGAZINE_SIZE * 3);
+	VERIFY(stats._magazine_exchange_count > 0);
+}
+
+
+//	Makes a vector when the thread exits, after the node pools have flushed the thread's caches.
+struct exit_allocator {
+	~exit_allocator(){
+		const auto a = push_back_n(1000, 0);
+		VERIFY(a.size() == 1000);
+	}
+};
+
+QUARK_UNIT_TEST("", "node_pool", "thread allocates after its cache was flushed at exit", "keeps no blocks"){
+	test_fixture<int> f;
+	const auto held_block_count = [](){
+		const auto stats = get_pool_stats(sizeof(leaf_node<int>));
+		return stats._heap_block_count - stats._depot_block_count;
+	};
+
+	const auto held0 = held_block_count();
+	std::thread t([](){
+		//	Constructed before the thread's first node, so it's destructed after the caches are flushed.
+		thread_local exit_allocator e;
+		(void)e;
+		const auto a = push_back_n(100, 0);
+		VERIFY(a.size() == 100);
+	});
+	t.join();
+	VERIFY(held_block_count() == held0);
+}
+
+
+////////////////////////////////////////////		set_allocator()
+
+
+struct counting_allocator : public heap_allocator {
+	public: virtual void* allocator_i__allocate(std::size_t size){
+		_allocate_count++;
+		_live_bytes += size;
+		return heap_allocator::allocator_i__allocate(size);
+	}
+
+	public: virtual void allocator_i__deallocate(void* p, std::size_t size){
+		_deallocate_count++;
+		_live_bytes -= size;
+		heap_allocator::allocator_i__deallocate(p, size);
+	}
+
+	public: std::atomic<std::size_t> _allocate_count{ 0 };
+	public: std::atomic<std::size_t> _deallocate_count{ 0 };
+	public: std::atomic<std::size_t> _live_bytes{ 0 };
+};
+
+struct scoped_allocator {
+	scoped_allocator(allocator_i* allocator) :
+		_prev(set_allocator(allocator))
+	{
+	}
+	~scoped_allocator(){
+		set_allocator(_prev);
+	}
+	allocator_i* _prev;
+};
+
+QUARK_UNIT_TEST("", "set_allocator()", "", "get_allocator() returns it"){
+	counting_allocator allocator;
+	VERIFY(get_allocator() == nullptr);
+	{
+		scoped_allocator scoped(&allocator);
+		VERIFY(get_allocator() == &allocator);
+	}
+	VERIFY(get_allocator() == nullptr);
+}
+
+QUARK_UNIT_TEST("", "set_allocator()", "push_back(), store(), pop_back()", "every node goes via allocator"){
+	test_fixture<int> f;
+	counting_allocator allocator;
+	{
+		scoped_allocator scoped(&allocator);
+
+		const auto a = push_back_n(1000, 0);
+		VERIFY(allocator._allocate_count - allocator._deallocate_count == get_inode_count<int>() + get_leaf_count<int>());
+
+		const auto b = a.store(3, 100).pop_back().pop_back();
+		VERIFY(b[3] == 100);
+		VERIFY(allocator._allocate_count - allocator._deallocate_count == get_inode_count<int>() + get_leaf_count<int>());
+	}
+	VERIFY(allocator._allocate_count > 0);
+	VERIFY(allocator._allocate_count == allocator._deallocate_count);
+	VERIFY(allocator._live_bytes == 0);
+}
+
+QUARK_UNIT_TEST("", "set_allocator()", "concatenated vector", "size tables go via allocator"){
+	test_fixture<int> f;
+	counting_allocator allocator;
+	{
+		scoped_allocator scoped(&allocator);
+
+		const auto a = make_relaxed_vector(300, 0);
+		VERIFY(a.get_root().get_inode()->_sizes != nullptr);
+		VERIFY(allocator._allocate_count > get_inode_count<int>() + get_leaf_count<int>());
+	}
+	VERIFY(allocator._allocate_count == allocator._deallocate_count);
+	VERIFY(allocator._live_bytes == 0);
+}
+
+
+////////////////////////////////////////////		single_thread
+
+
+QUARK_UNIT_TEST("vector<T, single_thread>", "", "", "plain reference counters"){
+	VERIFY((std::is_same<leaf_node<int, single_thread>::rc_t, int32_t>::value));
+	VERIFY((std::is_same<inode<int, single_thread>::rc_t, int32_t>::value));
+	VERIFY((std::is_same<leaf_node<int>::rc_t, std::atomic<int32_t>>::value));
+	VERIFY(sizeof(leaf_node<int, single_thread>) == sizeof(leaf_node<int>));
+}
+
+QUARK_UNIT_TEST("vector<T, single_thread>", "push_back(), store(), pop_back()", "", "same values as multi_thread"){
+	test_fixture<int, single_thread> f;
+	vector<int, single_thread> a;
+	for(int i = 0 ; i < 2000 ; i++){
+		a = a.push_back(i);
+	}
+	const auto b = a.store(1000, -1).pop_back();
+	VERIFY(b.size() == 1999);
+	VERIFY(b[1000] == -1);
+	VERIFY(b[1999 - 1] == 1998);
+	VERIFY(a[1000] == 1000);
+	VERIFY(get_leaf_count<int>() > 0);
+
+	const auto c = b + a.subvec(10, 20);
+	VERIFY(c.size() == 2009);
+	VERIFY(c[2000] == 11);
+	VERIFY((diff(a, a.store(7, 0)) == std::vector<std::pair<size_t, size_t>>{ { 7, 8 } }));
+
+	vector<int, single_thread>::transient t(a);
+	t.store(0, 100);
+	t.push_back(2000);
+	const auto d = t.persistent();
+	VERIFY(d[0] == 100 && d.size() == 2001);
+	VERIFY(std::accumulate(d.begin(), d.end(), 0) == std::accumulate(a.begin(), a.end(), 0) + 100 + 2000);
+}
+
+QUARK_UNIT_TEST("vector<T, single_thread>", "vector(const vector<T, RC2>& rhs)", "1000 values", "copies values, shares no nodes"){
+	test_fixture<int, single_thread> f;
+	test_fixture<int> f2;
+
+	const auto a = make_relaxed_vector(100, 0);
+	const vector<int, single_thread> b(a);
+	VERIFY(b.size() == a.size());
+	VERIFY(std::equal(a.begin(), a.end(), b.begin()));
+
+	const vector<int> c(b.store(3, -1));
+	VERIFY(c.size() == a.size());
+	VERIFY(c[3] == -1);
+	VERIFY(c.subvec(4, c.size()) == a.subvec(4, a.size()));
+	VERIFY(c.get_root().get_inode()->_rc == 1);
+}
+
+QUARK_UNIT_TEST("vector<T, single_thread>", "vector(const vector<T, RC2>& rhs)", "relaxed vector", "same tree as vector(const std::vector<T>&)"){
+	test_fixture<int, single_thread> f;
+	test_fixture<int> f2;
+
+	const auto a = make_relaxed_vector(300, 0).subvec(5, 4000);
+	const vector<int, single_thread> b(a);
+	const vector<int, single_thread> c(a.to_vec());
+	VERIFY(b.check_invariant());
+	VERIFY(b.to_vec() == a.to_vec());
+	VERIFY(b.get_shift() == c.get_shift());
+	VERIFY(b.get_tree_size() == c.get_tree_size());
+	VERIFY(b.get_root().get_inode()->_sizes == nullptr);
+}
+
+QUARK_UNIT_TEST("vector<T, single_thread>", "vector(const vector<T, RC2>& rhs)", "hand over to other thread", "correct values"){
+	test_fixture<int, single_thread> f;
+	test_fixture<int> f2;
+
+	const vector<int, single_thread> a(push_back_n(1000, 0));
+	const vector<int> shared(a);
+	long sum = 0;
+	std::thread t([&](){ sum = std::accumulate(shared.begin(), shared.end(), 0L); });
+	t.join();
+	VERIFY(sum == std::accumulate(a.begin(), a.end(), 0L));
+}
+
+
+////////////////////////////////////////////		biased_thread
+
+
+QUARK_UNIT_TEST("vector<T, biased_thread>", "push_back(), store(), operator+()", "one thread", "counts in owner count"){
+	test_fixture<int, biased_thread> f;
+	vector<int, biased_thread> a;
+	for(int i = 0 ; i < 2000 ; i++){
+		a = a.push_back(i);
+	}
+	const auto b = a.store(1000, -1).pop_back() + a.subvec(10, 20);
+	VERIFY(b.size() == 2009);
+	VERIFY(b[1000] == -1 && b[2000] == 11);
+
+	const auto& rc = a.get_root().get_inode()->_rc;
+	VERIFY(rc._owner.load() == get_biased_record_slot());
+	VERIFY(rc._shared.load() == 0);
+	VERIFY(rc == 1);
+}
+
+QUARK_UNIT_TEST("vector<T, biased_thread>", "", "copied and released by other threads", "no leaks"){
+	test_fixture<int, biased_thread> f;
+	vector<int, biased_thread> a(generate_numbers(0, 1000, 1000));
+	for(int i = 0 ; i < 4 ; i++){
+		auto b = a;
+		std::thread t([&](){
+			const auto c = b.store(3, -1);
+			VERIFY(c[3] == -1);
+
+			//	Releases a reference that this thread counted: negative shared count, queues the nodes.
+			b = vector<int, biased_thread>();
+		});
+		t.join();
+		VERIFY(b.empty());
+	}
+	test_values(a, 0);
+}
+
+QUARK_UNIT_TEST("vector<T, biased_thread>", "", "made by a thread that has exited", "no leaks"){
+	test_fixture<int, biased_thread> f;
+	vector<int, biased_thread> a;
+	std::thread t([&](){
+		a = vector<int, biased_thread>(generate_numbers(0, 1000, 1000));
+	});
+	t.join();
+	test_values(a, 0);
+
+	const auto b = a.store(1, 100);
+	VERIFY(b[1] == 100);
+}
+
+/*
+	The owner holds a and b. Thread X releases b and is about to queue the node, thread Y copies a to c and hands c to
+	the owner, which releases a and c - before X has queued the node.
+*/
+QUARK_UNIT_TEST("vector<T, biased_thread>", "release()", "owner gets to 0 while another thread queues the node", "merged once, no leaks"){
+	test_fixture<int, biased_thread> f;
+	typedef biased_thread::rc_t rc_t;
+	const auto node = leaf_node<int, biased_thread>::make(4);
+	const auto me = get_biased_record_slot();
+	//	Counts the node.
+	const auto owners = me->_owners.load();
+	biased_thread::retain(node);
+	biased_thread::retain(node);
+
+	//	X's part of release(): takes the shared count negative and claims queuing.
+	node->_rc._shared.store(-rc_t::ONE | rc_t::QUEUED);
+
+	std::thread y([&](){
+		biased_thread::retain(node);
+	});
+	y.join();
+
+	biased_thread::release(node);
+	biased_thread::release(node);
+	VERIFY(node->_rc._owner.load() == me);
+
+	std::thread x([&](){
+		queue_biased_node(node);
+	});
+	x.join();
+
+	merge_biased_queue(me);
+	VERIFY(me->_owners.load() == owners - 1);
+}
+
+QUARK_UNIT_TEST("vector<T, biased_thread>", "", "thread made nodes and exited", "record deleted with its last node"){
+	test_fixture<int, biased_thread> f;
+	const auto records = get_biased_record_count().load();
+	vector<int, biased_thread> a;
+	std::thread t([&](){
+		a = vector<int, biased_thread>(generate_numbers(0, 1000, 1000));
+	});
+	t.join();
+	VERIFY(get_biased_record_count() == records + 1);
+
+	a = vector<int, biased_thread>();
+	VERIFY(get_biased_record_count() == records);
+
+	std::thread t2([&](){
+		const auto b = vector<int, biased_thread>(generate_numbers(0, 1000, 1000));
+		VERIFY(b.size() == 1000);
+	});
+	t2.join();
+	VERIFY(get_biased_record_count() == records);
+}
+
+
+////////////////////////////////////////////		Move semantics
+
+
+//	Like single_thread but counts every change of a reference counter.
+struct counting_thread {
+	typedef int32_t rc_t;
+
+	template <class NODE> static void retain(NODE* node){
+		_count++;
+		single_thread::retain(node);
+	}
+
+	template <class NODE> static void release(NODE* node){
+		_count++;
+		single_thread::release(node);
+	}
+
+	template <class NODE> static bool is_unique(const NODE* node){
+		return single_thread::is_unique(node);
+	}
+
+	static int64_t _count;
+};
+
+int64_t counting_thread::_count = 0;
+
+QUARK_UNIT_TEST("vector", "vector(vector&& rhs), operator=(vector&& rhs)", "1000 values", "takes over the nodes, rhs is empty"){
+	test_fixture<int> f;
+	vector<int> a(generate_numbers(0, 1000, 1000));
+	const auto root = a.get_root()._ptr;
+
+	vector<int> b(std::move(a));
+	VERIFY(a.empty() && a.get_root().get_type() == node_type::null_node);
+	VERIFY(b.get_root()._ptr == root);
+	VERIFY(b.get_root().get_inode()->_rc == 1);
+	test_values(b, 0);
+
+	a = std::move(b);
+	VERIFY(b.empty());
+	VERIFY(a.get_root()._ptr == root);
+	test_values(a, 0);
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "vector(vector&& rhs)", "3 values", "copies inline values, rhs is empty"){
+	vector<inline_pixel> a(make_pixels(3));
+	vector<inline_pixel> b(std::move(a));
+	VERIFY(a.empty());
+	VERIFY(b.is_inline() && b.to_vec() == make_pixels(3));
+}
+
+QUARK_UNIT_TEST("vector<T, counting_thread>", "push_back()", "a = a.push_back() 10000 times", "few reference counter changes"){
+	test_fixture<int, counting_thread> f;
+	vector<int, counting_thread> a;
+	counting_thread::_count = 0;
+	for(int i = 0 ; i < 10000 ; i++){
+		a = a.push_back(i);
+	}
+
+	//	Retain + release of root and tail per push_back, plus a path copy once every leaf node.
+	VERIFY(counting_thread::_count < 10000 * 10);
+	VERIFY(a.size() == 10000 && a[9999] == 9999);
+}
+
+
+////////////////////////////////////////////		Rvalue edits
+
+
+/*
+	Edits a vector with the rvalue functions while keeping copies of some versions on the side, and checks all
+	versions against std::vectors all along.
+*/
+template <class RC>
+void test_rvalue_edits(int count){
+	vector<int, RC> a;
+	std::vector<int> ref;
+	std::vector<std::pair<vector<int, RC>, std::vector<int>>> versions;
+
+	for(int i = 0 ; i < count ; i++){
+		if(i % 97 == 0){
+			versions.push_back({ a, ref });
+		}
+		if(i % 5 == 4){
+			a = std::move(a).store(i / 2, -i);
+			ref[i / 2] = -i;
+		}
+		else if(i % 7 == 6){
+			a = std::move(a).pop_back();
+			ref.pop_back();
+		}
+		else if(i % 11 == 10){
+			const auto values = generate_numbers(i, 40, 40);
+			a = std::move(a).push_back(values);
+			ref.insert(ref.end(), values.begin(), values.end());
+		}
+		else{
+			a = std::move(a).push_back(i);
+			ref.push_back(i);
+		}
+	}
+
+	VERIFY(a.to_vec() == ref);
+	for(const auto& v: versions){
+		VERIFY(v.first.to_vec() == v.second);
+	}
+}
+
+QUARK_UNIT_TEST("vector", "std::move(a).push_back(), store(), pop_back()", "3000 edits, versions kept", "all versions correct"){
+	test_fixture<int> f;
+	test_rvalue_edits<multi_thread>(3000);
+}
+
+QUARK_UNIT_TEST("vector<T, single_thread>", "std::move(a).push_back(), store(), pop_back()", "3000 edits, versions kept", "all versions correct"){
+	test_fixture<int, single_thread> f;
+	test_rvalue_edits<single_thread>(3000);
+}
+
+QUARK_UNIT_TEST("vector<T, biased_thread>", "std::move(a).push_back(), store(), pop_back()", "3000 edits, versions kept", "all versions correct"){
+	test_fixture<int, biased_thread> f;
+	test_rvalue_edits<biased_thread>(3000);
+}
+
+QUARK_UNIT_TEST("vector", "std::move(a).store()", "unique vector, 4 levels", "no new nodes, same root"){
+	test_fixture<int> f;
+	vector<int> a(generate_numbers(0, 40000, 40000));
+	const auto root = a.get_root()._ptr;
+	const auto inode_count = inode<int>::_debug_count;
+	const auto leaf_count = leaf_node<int>::_debug_count;
+
+	for(int i = 0 ; i < 40000 ; i += 101){
+		a = std::move(a).store(i, -i);
+	}
+	VERIFY(inode<int>::_debug_count == inode_count);
+	VERIFY(leaf_node<int>::_debug_count == leaf_count);
+	VERIFY(a.get_root()._ptr == root);
+	VERIFY(a[101] == -101 && a[102] == 102);
+}
+
+QUARK_UNIT_TEST("vector", "std::move(a).store()", "shared vector", "copies, b is unchanged"){
+	test_fixture<int> f;
+	vector<int> a(generate_numbers(0, 1000, 1000));
+	const auto b = a;
+	a = std::move(a).store(10, -10);
+	a = std::move(a).store(999, -999);
+	VERIFY(a[10] == -10 && a[999] == -999);
+	test_values(b, 0);
+}
+
+QUARK_UNIT_TEST("vector<T, counting_thread>", "std::move(a).push_back()", "10000 values", "a third of the reference counter changes"){
+	test_fixture<int, counting_thread> f;
+	vector<int, counting_thread> a;
+	vector<int, counting_thread> b;
+	counting_thread::_count = 0;
+	for(int i = 0 ; i < 10000 ; i++){
+		a = a.push_back(i);
+	}
+	const auto lvalue_count = counting_thread::_count;
+
+	counting_thread::_count = 0;
+	for(int i = 0 ; i < 10000 ; i++){
+		b = std::move(b).push_back(i);
+	}
+	VERIFY(counting_thread::_count * 3 < lvalue_count);
+	VERIFY(a == b);
+}
+
+QUARK_UNIT_TEST("vector", "std::move(b).push_back()", "tail used past the end by a released vector", "reuses the tail"){
+	test_fixture<int> f;
+	auto a = vector<int>(generate_numbers(0, 40, 40));
+	auto b = a.pop_back().pop_back();
+	a = vector<int>();
+
+	const auto tail = b.get_tail()._ptr;
+	b = std::move(b).push_back(-1);
+	VERIFY(b.get_tail()._ptr == tail);
+	VERIFY(b.get_tail().get_leaf_node()->_used == 7);
+	VERIFY(b[37] == 37 && b[38] == -1 && b.size() == 39);
+}
+
+
+////////////////////////////////////////////		set_deferred_reclamation()
+
+
+QUARK_UNIT_TEST("", "set_deferred_reclamation()", "release 10000 values, budget 4", "deletes 4 nodes per release"){
+	test_fixture<int> f;
+	const auto node_count = [](){ return inode<int, multi_thread>::_debug_count + leaf_node<int, multi_thread>::_debug_count; };
+	const auto count0 = node_count();
+
+	vector<int> b{ 3 };
+	set_deferred_reclamation(true, 4);
+	{
+		vector<int> a(generate_numbers(0, 10000, 10000));
+		VERIFY(node_count() > count0 + 300);
+	}
+	VERIFY(node_count() > count0 + 300);
+	const auto count1 = node_count();
+	const auto deferred1 = get_deferred_node_count();
+	VERIFY(deferred1 > 0);
+
+	//	Releasing b's leaf node deletes it and 3 of a's deferred nodes.
+	b = vector<int>();
+	VERIFY(node_count() == count1 - 4);
+
+	set_deferred_reclamation(false);
+	VERIFY(reclaim_deferred_nodes(10) == 10);
+	VERIFY(reclaim_deferred_nodes() > 0);
+	VERIFY(get_deferred_node_count() == 0);
+	VERIFY(node_count() == count0);
+}
+
+QUARK_UNIT_TEST("", "set_deferred_reclamation()", "disabled again, release other vector", "deletes it all, keeps deferred nodes"){
+	test_fixture<int> f;
+	const auto node_count = [](){ return inode<int, multi_thread>::_debug_count + leaf_node<int, multi_thread>::_debug_count; };
+
+	set_deferred_reclamation(true, 0);
+	{
+		vector<int> a(generate_numbers(0, 1000, 1000));
+	}
+	set_deferred_reclamation(false);
+	const auto deferred_count = get_deferred_node_count();
+	VERIFY(deferred_count > 0);
+
+	const auto count1 = node_count();
+	{
+		vector<int> b(generate_numbers(0, 100000, 100000));
+	}
+	VERIFY(node_count() == count1);
+	VERIFY(get_deferred_node_count() == deferred_count);
+
+	VERIFY(reclaim_deferred_nodes() > 0);
+}
+
+QUARK_UNIT_TEST("vector", "~vector()", "4 levels, 2000000 values", "deletes all nodes without recursing"){
+	test_fixture<int> f;
+	{
+		vector<int> a(generate_numbers(0, 2000000, 2000000));
+		VERIFY(a.size() == 2000000);
+	}
+	VERIFY(get_deferred_node_count() == 0);
+}
+
+QUARK_UNIT_TEST("", "set_deferred_reclamation()", "budget 0, thread exits", "thread exit deletes deferred nodes"){
+	test_fixture<int> f;
+	std::thread t([&](){
+		set_deferred_reclamation(true, 0);
+		vector<int> a(generate_numbers(0, 1000, 1000));
+		a = vector<int>();
+		VERIFY(get_deferred_node_count() > 0);
+	});
+	t.join();
+	VERIFY(get_deferred_node_count() == 0);
+}
+
+
+////////////////////////////////////////////		T = std::string
+
+
+
+QUARK_UNIT_TEST("vector", "operator+()", "3 + 4 values", "7 values"){
+	using std::string;
+	test_fixture<string> f;
+
+	const steady::vector<string> a{ "one", "two", "three" };
+
+	const steady::vector<string> b{ "four", "five" };
+	const auto c = a + b;
+
+	assert(a == (steady::vector<string>{ "one", "two", "three" }));
+	assert(b == (steady::vector<string>{ "four", "five" }));
+	assert(c == (steady::vector<string>{ "one", "two", "three", "four", "five" }));
+}
+
+
+
+////////////////////////////////////////////		T without default constructor
+
+
+//	Counts how many instances are alive. Has no default constructor.
+struct live_value {
+	explicit live_value(int value) : _value(value) { _live_count++; }
+	live_value(const live_value& other) : _value(other._value) { _live_count++; }
+	live_value& operator=(const live_value& other) = default;
+	~live_value(){ _live_count--; }
+
+	bool operator==(const live_value& other) const { return _value == other._value; }
+
+	int _value;
+	static int _live_count;
+};
+
+int live_value::_live_count = 0;
+
+QUARK_UNIT_TEST("vector<live_value>", "push_back()", "100 values", "constructs only the used values"){
+	test_fixture<live_value> f;
+	{
+		vector<live_value> a;
+		for(int i = 0 ; i < 100 ; i++){
+			a = a.push_back(live_value(i));
+		}
+		VERIFY(a.size() == 100);
+		VERIFY(live_value::_live_count == 100);
+
+		//	Copies the leaf node holding index 5: all its 32 values.
+		const auto b = a.store(5, live_value(-1));
+		VERIFY(live_value::_live_count == 100 + BRANCHING_FACTOR);
+		VERIFY(b[5]._value == -1);
+		VERIFY(a[5]._value == 5);
+
+		const auto c = a + b;
+		VERIFY(c.size() == 200);
+		VERIFY(c[105]._value == -1);
+	}
+	VERIFY(live_value::_live_count == 0);
+}
+
+QUARK_UNIT_TEST("vector<live_value>::transient", "push_back(), pop_back()", "", "destructs popped values"){
+	test_fixture<live_value> f;
+	{
+		vector<live_value>::transient t;
+		for(int i = 0 ; i < 40 ; i++){
+			t.push_back(live_value(i));
+		}
+		VERIFY(live_value::_live_count == 40);
+
+		t.pop_back();
+		t.pop_back();
+		VERIFY(live_value::_live_count == 38);
+		VERIFY(t.size() == 38 && t[37]._value == 37);
+	}
+	VERIFY(live_value::_live_count == 0);
+}
+
+
+
+////////////////////////////////////////////		Moving values in
+
+
+//	Counts copies and moves. Constructed from two ints, for emplace_back(). A moved-from value is -1.
+struct move_counted {
+	move_counted(int a, int b) : _value(a * 1000 + b) {}
+	move_counted(const move_counted& other) : _value(other._value) { _copy_count++; }
+	move_counted(move_counted&& other) noexcept : _value(other._value) { other._value = -1; _move_count++; }
+	move_counted& operator=(const move_counted& other) = default;
+
+	bool operator==(const move_counted& other) const { return _value == other._value; }
+
+	int _value;
+	static int _copy_count;
+	static int _move_count;
+};
+
+int move_counted::_copy_count = 0;
+int move_counted::_move_count = 0;
+
+std::vector<move_counted> make_move_counted(int count){
+	std::vector<move_counted> result;
+	for(int i = 0 ; i < count ; i++){
+		result.emplace_back(i, 7);
+	}
+	move_counted::_copy_count = 0;
+	move_counted::_move_count = 0;
+	return result;
+}
+
+QUARK_UNIT_TEST("vector", "std::move(a).emplace_back()", "100 values", "constructed in place, tail growth moves"){
+	test_fixture<move_counted> f;
+	move_counted::_copy_count = 0;
+	move_counted::_move_count = 0;
+
+	vector<move_counted> a;
+	for(int i = 0 ; i < 100 ; i++){
+		a = std::move(a).emplace_back(i, 3);
+	}
+	VERIFY(a.size() == 100);
+	VERIFY(a[0]._value == 3 && a[99]._value == 99003);
+	VERIFY(move_counted::_copy_count == 0);
+
+	//	The first tail grows 1, 2, 4 ... 32.
+	VERIFY(move_counted::_move_count == 1 + 2 + 4 + 8 + 16);
+}
+
+QUARK_UNIT_TEST("vector", "emplace_back()", "shared tail", "copies tail, original unchanged"){
+	test_fixture<move_counted> f;
+	const auto a = vector<move_counted>().emplace_back(1, 2).emplace_back(3, 4);
+	auto b = a.pop_back();
+	b = std::move(b).emplace_back(5, 6);
+	VERIFY(a.size() == 2 && a[1]._value == 3004);
+	VERIFY(b.size() == 2 && b[1]._value == 5006);
+	VERIFY(a[0]._value == 1002 && b[0]._value == 1002);
+}
+
+QUARK_UNIT_TEST("vector", "push_back(std::vector<T>&&)", "1 + 1000 values", "moves the 1000 values"){
+	test_fixture<move_counted> f;
+	auto values = make_move_counted(1000);
+	const auto a = vector<move_counted>().emplace_back(5, 5);
+	move_counted::_copy_count = 0;
+
+	const auto b = a.push_back(std::move(values));
+	VERIFY(b.size() == 1001);
+	VERIFY(b[1]._value == 7 && b[1000]._value == 999007);
+
+	//	Only a's value is copied: a keeps using its tail.
+	VERIFY(move_counted::_copy_count == 1);
+	VERIFY(move_counted::_move_count == 1000);
+	VERIFY(values[999]._value == -1);
+	VERIFY(a.size() == 1);
+}
+
+QUARK_UNIT_TEST("vector", "std::move(a).push_back(std::vector<T>&&)", "3 x 50 values", "moves values, no copies"){
+	test_fixture<move_counted> f;
+	vector<move_counted> a;
+	for(int i = 0 ; i < 3 ; i++){
+		auto values = make_move_counted(50);
+		a = std::move(a).push_back(std::move(values));
+		VERIFY(move_counted::_copy_count == 0);
+	}
+	VERIFY(a.size() == 150);
+	VERIFY(a[149]._value == 49007);
+}
+
+QUARK_UNIT_TEST("vector", "vector(std::vector<T>&&)", "1000 values", "moves values, no copies"){
+	test_fixture<move_counted> f;
+	auto values = make_move_counted(1000);
+	const vector<move_counted> a(std::move(values));
+	VERIFY(a.size() == 1000);
+	VERIFY(a[0]._value == 7 && a[999]._value == 999007);
+	VERIFY(move_counted::_copy_count == 0);
+	VERIFY(move_counted::_move_count == 1000);
+}
+
+QUARK_UNIT_TEST("vector::transient", "emplace_back()", "100 values", "constructed in place, tail growth moves"){
+	test_fixture<move_counted> f;
+	move_counted::_copy_count = 0;
+	move_counted::_move_count = 0;
+
+	vector<move_counted>::transient t;
+	for(int i = 0 ; i < 100 ; i++){
+		t.emplace_back(i, 1);
+	}
+	const auto a = t.persistent();
+	VERIFY(a.size() == 100 && a[99]._value == 99001);
+	VERIFY(move_counted::_copy_count == 0);
+}
+
+QUARK_UNIT_TEST("vector<inline_pixel>", "push_back(std::vector<T>&&)", "2 + 2 values, 2 + 40 values", "inline, then tree"){
+	test_fixture<inline_pixel> f;
+	const auto a = vector<inline_pixel>().push_back(make_pixel(1)).push_back(make_pixel(2));
+
+	const auto b = a.push_back(std::vector<inline_pixel>{ make_pixel(3), make_pixel(4) });
+	VERIFY(b.is_inline() && b.size() == 4 && b[3] == make_pixel(4));
+
+	const auto pixels = make_pixels(40);
+	const auto c = a.push_back(std::vector<inline_pixel>(pixels));
+	VERIFY(!c.is_inline() && c.size() == 42 && c[41] == pixels[39]);
 }
 
 
@@ -22,7 +22,15 @@
 
 #include "quark.h"
 #include <initializer_list>
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <memory>
+#include <type_traits>
+#include <iterator>
 #include <vector>
 #include <array>
 #include <sstream>
@@ -53,1486 +61,5402 @@ namespace steady {
 	static const int BRANCHING_FACTOR = 1 << BRANCHING_FACTOR_SHIFT;
 
 
-	namespace internals {
-		template <typename T> struct node_ref;
-		template <typename T> struct inode;
-		template <typename T> struct leaf_node;
+	/*
+		Counters for one of the pools that nodes are allocated from. See get_node_pool_stats().
+		The blocks in use are the heap blocks minus the free ones in the depot and in the caches of the threads.
+	*/
+	struct node_pool_stats {
+		//	Size of each block, in bytes.
+		public: size_t _block_size;
 
-		static const size_t BRANCHING_FACTOR_MASK = (BRANCHING_FACTOR - 1);
+		//	Number of blocks ever allocated from the heap.
+		public: size_t _heap_block_count;
 
-		static const int EMPTY_TREE_SHIFT = -BRANCHING_FACTOR_SHIFT;
-		static const int LEAF_NODE_SHIFT = 0;
-		static const int LOWEST_LEVEL_INODE_SHIFT = BRANCHING_FACTOR_SHIFT;
+		//	Number of free blocks in the shared depot. Does not include the free blocks cached by each thread.
+		public: size_t _depot_block_count;
 
+		//	Number of times a thread has handed a magazine of free blocks to the depot or taken one from it.
+		public: size_t _magazine_exchange_count;
+	};
 
-		////////////////////////////////////////////		node_type
 
-		enum class node_type {
-			null_node = 4,
-			inode,
-			leaf_node
-		};
+	////////////////////////////////////////////		Node reclamation
 
+	/*
+		Nodes are never deleted recursively. Deleting an inode releases its children and any child that gets
+		to reference count 0 goes on a work list of the thread instead of being deleted inside the inode's
+		destructor. The outermost dispose_node() then deletes the nodes on the list, one by one. This keeps the
+		stack depth constant however big or deep the tree is. Leaf nodes can't hold nodes so they skip the list:
+		the leaf nodes of an inode are deleted together, by its destructor.
 
-		////////////////////////////////////////////		Utility functions
+		The same list holds the nodes postponed by deferred reclamation, see set_deferred_reclamation().
+	*/
 
+	namespace internals {
 
-		/*
-			### To be documented.
-		*/
-		inline size_t divide_round_up(size_t value, size_t align){
-			const auto r = value / align;
-			return r * align < value ? r + 1 : r;
+		struct deferred_node {
+			public: void* _node;
+			public: void (*_delete_node)(void* node);
+		};
+
+		template <typename T, typename RC> struct leaf_node;
+
+		template <class NODE>
+		void destroy_node(NODE* node){
+			delete node;
 		}
 
-		/*
-			Returns how deep node hiearchy is for a tree with *count* values. Counts both leaf-nodes and inodes.
-			0: empty
-			1: one leaf node.
-			2: one inode with 1-4 leaf nodes.
-			3: two levels of inodes plus leaf nodes.
-		*/
-		inline int count_to_depth(size_t count){
-			const auto leaf_count = divide_round_up(count, BRANCHING_FACTOR);
+		template <class T, class RC>
+		void destroy_node(leaf_node<T, RC>* node){
+			leaf_node<T, RC>::destroy(node);
+		}
 
-			if(leaf_count == 0){
-				return 0;
-			}
-			else if(leaf_count == 1){
-				return 1;
-			}
-			else {
-				return 1 + count_to_depth(leaf_count);
-			}
+		template <class NODE>
+		void delete_node(void* node){
+			destroy_node(static_cast<NODE*>(node));
 		}
 
-		/*
-			Given a shift value, how many values can this tree hold without introduce more levels of inodes?
-		*/
-		inline size_t shift_to_max_size(int shift){
-			const size_t size = BRANCHING_FACTOR << shift;
-			return size;
+		//	Plain thread_locals: cheap to check on every release and still usable while the thread exits.
+		inline bool& get_deferred_enabled(){
+			static thread_local bool enabled = false;
+			return enabled;
 		}
 
-		/*
-			Return how many steps to shift vector-index to get its *top-level* bits.
+		inline std::size_t& get_deferred_budget(){
+			static thread_local std::size_t budget = 0;
+			return budget;
+		}
 
-			-BRANCHING_FACTOR_SHIFT: empty tree
-			0: leaf-node level
-			BRANCHING_FACTOR_SHIFT: inode1 (inode that points to leafnodes)
-			>=BRANCHING_FACTOR_SHIFT: inode that points to inodes.
-		*/
-		inline int vector_size_to_shift(size_t size){
-			const int shift = (count_to_depth(size) - 1) * BRANCHING_FACTOR_SHIFT;
-			return shift;
+		//	The work list has been destroyed: the thread is exiting. Nodes are deleted directly from then on.
+		inline bool& get_deferred_exited(){
+			static thread_local bool exited = false;
+			return exited;
 		}
 
+		struct deferred_nodes {
+			public: ~deferred_nodes(){
+				get_deferred_enabled() = false;
+				_deleting = true;
+				while(!_nodes.empty()){
+					const auto n = _nodes.back();
+					_nodes.pop_back();
+					n._delete_node(n._node);
+				}
+				get_deferred_exited() = true;
+			}
+
+			public: std::vector<deferred_node> _nodes;
 
+			//	A node is being deleted: nodes released by its destructor go on _nodes.
+			public: bool _deleting = false;
+		};
 
-		////////////////////////////////////////////		leaf_node
+		inline deferred_nodes& get_deferred_nodes(){
+			static thread_local deferred_nodes nodes;
+			return nodes;
+		}
 
-		/*
-			This object holds a number of values, of type T.
-			These nodes live at the bottom of an inode tree.
+		//	Deletes nodes from the end of the list until it has _end_ nodes left, or _max_count_ nodes are deleted.
+		inline std::size_t delete_nodes(deferred_nodes& list, std::size_t end, std::size_t max_count){
+			STEADY_ASSERT(list._deleting == false);
+
+			list._deleting = true;
+			std::size_t count = 0;
+			while(count < max_count && list._nodes.size() > end){
+				const auto n = list._nodes.back();
+				list._nodes.pop_back();
+				const auto size = list._nodes.size();
+				n._delete_node(n._node);
+
+				//	Delete its children first to last, in the order they were made. Noticeably faster than backwards.
+				std::reverse(list._nodes.begin() + size, list._nodes.end());
+				count++;
+			}
+			list._deleting = false;
+			return count;
+		}
 
-			Holds an intrusive reference counter that is used by client code.
+		/*
+			Deletes up to _max_count_ of the calling thread's deferred nodes. Children released by deleting a node
+			are deferred in turn, so each step is bounded by the size of one node.
 		*/
+		inline std::size_t reclaim_deferred(std::size_t max_count){
+			auto& list = get_deferred_nodes();
+			return list._deleting ? 0 : delete_nodes(list, 0, max_count);
+		}
 
-		template <class T>
-		struct leaf_node {
-			public: leaf_node() :
-				_rc(0)
-			{
-				_debug_count++;
-				STEADY_ASSERT(check_invariant());
+		//	Releasing never throws: if the list can't grow the node is deleted right away, recursing.
+		inline bool push_node(deferred_nodes& list, void* node, void (*delete_node_f)(void* node)){
+			try {
+				list._nodes.push_back(deferred_node{ node, delete_node_f });
+				return true;
 			}
-
-			public: leaf_node(const std::array<T, BRANCHING_FACTOR>& values) :
-				_rc(0),
-				_values(values)
-			{
-				_debug_count++;
-				STEADY_ASSERT(check_invariant());
+			catch(const std::bad_alloc&){
+				delete_node_f(node);
+				return false;
 			}
+		}
 
-			public: ~leaf_node(){
-				STEADY_ASSERT(check_invariant());
-				STEADY_ASSERT(_rc == 0);
+		//	Called by the reference counting policies when a node has no references left.
+		inline void dispose_node(void* node, void (*delete_node_f)(void* node)){
+			if(get_deferred_exited()){
+				delete_node_f(node);
+				return;
+			}
 
-				_debug_count--;
+			auto& list = get_deferred_nodes();
+			if(list._deleting){
+				push_node(list, node, delete_node_f);
+			}
+			else if(get_deferred_enabled()){
+				if(push_node(list, node, delete_node_f)){
+					delete_nodes(list, 0, get_deferred_budget());
+				}
 			}
+			else{
+				//	Nodes deferred earlier stay below _end_.
+				const auto end = list._nodes.size();
+				list._deleting = true;
+				delete_node_f(node);
+				list._deleting = false;
+				delete_nodes(list, end, SIZE_MAX);
+			}
+		}
 
-			public: bool check_invariant() const {
-				STEADY_ASSERT(_rc >= 0);
-				STEADY_ASSERT(_rc < 1000);
-				STEADY_ASSERT(_values.size() == BRANCHING_FACTOR);
-				return true;
+		template <class NODE>
+		void dispose_node(NODE* node){
+			dispose_node(node, &delete_node<NODE>);
+		}
+
+		//	Leaf nodes hold no nodes, deleting them never recurses: unless deferred, delete them right away.
+		template <class T, class RC>
+		void dispose_node(leaf_node<T, RC>* node){
+			if(get_deferred_enabled()){
+				dispose_node(node, &delete_node<leaf_node<T, RC>>);
+			}
+			else{
+				leaf_node<T, RC>::destroy(node);
 			}
+		}
 
-			private: leaf_node<T>& operator=(const leaf_node& rhs);
-			private: leaf_node(const leaf_node& rhs);
+	}	//	internals
 
 
-			//////////////////////////////	State
+	/*
+		Opt-in, per thread: when the last reference to a big vector goes away, its nodes are normally deleted at
+		once, which can take milliseconds. With deferred reclamation, released nodes are put on a list of the calling
+		thread instead and each release then deletes at most _budget_ nodes from the list. Releasing a vector costs
+		O(budget) no matter its size and the memory comes back gradually.
+
+		enabled: false => nodes are deleted directly. Nodes already deferred stay until reclaim_deferred_nodes()
+			is called or the thread exits.
+		budget: nodes to delete from the list on each release. 0: only reclaim_deferred_nodes() deletes nodes.
+	*/
+	inline void set_deferred_reclamation(bool enabled, std::size_t budget = 4){
+		internals::get_deferred_enabled() = enabled;
+		internals::get_deferred_budget() = budget;
+	}
 
-			public: std::atomic<int32_t> _rc;
-			public: std::array<T, BRANCHING_FACTOR> _values{};
-			public: static int _debug_count;
-		};
+	//	Deletes up to _max_count_ deferred nodes of the calling thread, for example when it is idle. Returns how many.
+	inline std::size_t reclaim_deferred_nodes(std::size_t max_count = SIZE_MAX){
+		return internals::reclaim_deferred(max_count);
+	}
 
-		template <class T>
-		int leaf_node<T>::_debug_count = 0;
+	//	Number of nodes the calling thread has released but not deleted yet.
+	inline std::size_t get_deferred_node_count(){
+		return internals::get_deferred_nodes()._nodes.size();
+	}
 
 
+	////////////////////////////////////////////		Reference counting policies
 
-		////////////////////////////////////////////		inode
+	/*
+		The second template parameter of vector<T, RC> decides how nodes count their references.
 
-		/*
-			An inode is used to hold leaf nodes when more than one leaf node is needed. It can also hold other inodes.
+		multi_thread: the default. Atomic counters - vectors can be copied and released by any thread, at any time.
 
-			An inode has these states:
-				full set of iNode pointers or
-				full set of leaf node pointers or
-				empty vector.
+		single_thread: plain integers, so copying and releasing nodes uses no locked instructions. All vectors
+		that share nodes with each other must only be used by one thread at a time. To hand values to another thread,
+		convert to vector<T, multi_thread>: the conversion copies the values into new nodes, so the new vector
+		shares nothing with the single_thread one.
 
-			You cannot mix sub-inode and sub-leaf nodes in the same inode.
-			inode pointers and leaf node pointers can be null, but the nulls are always at the end of the arrays.
+		biased_thread: see below.
 
-			Holds an intrusive reference counter that is used by client code.
-		*/
+		A policy has the counter type rc_t and retain() / release() that add and remove a reference to a node.
+		release() disposes the node when there are no references left. is_unique() tells if the caller holds the
+		only reference to a node, so it can be edited in place. It may answer false when unsure.
+	*/
+	struct multi_thread {
+		typedef std::atomic<int32_t> rc_t;
 
-		template <class T>
-		struct inode {
-			public: typedef std::array<node_ref<T>, BRANCHING_FACTOR> children_t;
+		template <class NODE> static void retain(NODE* node){
+			node->_rc++;
+		}
 
-			//	children: 0-32 children, all of the same type. kNullNodes can only appear at end of vector.
-			public: inode(const children_t& children2) :
-				_rc(0),
-				_children(children2)
-			{
-				STEADY_ASSERT(children2.size() >= 0);
-				STEADY_ASSERT(children2.size() <= BRANCHING_FACTOR);
-		#if STEADY_ASSERT_ON
-				for(auto i: children2){
-					i.check_invariant();
-				}
-		#endif
+		//	Acquire: we see all the writes of the threads that released the other references.
+		template <class NODE> static bool is_unique(const NODE* node){
+			return node->_rc.load(std::memory_order_acquire) == 1;
+		}
 
-				_debug_count++;
-				STEADY_ASSERT(check_invariant());
+		template <class NODE> static void release(NODE* node){
+			if(--node->_rc == 0){
+				internals::dispose_node(node);
 			}
+		}
+	};
 
+	struct single_thread {
+		typedef int32_t rc_t;
 
-			public: ~inode(){
-				STEADY_ASSERT(check_invariant());
-				STEADY_ASSERT(_rc == 0);
+		template <class NODE> static void retain(NODE* node){
+			node->_rc++;
+		}
 
-				_debug_count--;
+		template <class NODE> static bool is_unique(const NODE* node){
+			return node->_rc == 1;
+		}
+
+		template <class NODE> static void release(NODE* node){
+			if(--node->_rc == 0){
+				internals::dispose_node(node);
 			}
+		}
+	};
 
-			private: inode<T>& operator=(const inode& rhs);
-			private: inode(const inode& rhs);
 
-			public: bool check_invariant() const {
-				STEADY_ASSERT(_rc >= 0);
-				STEADY_ASSERT(_rc < 10000);
-				STEADY_ASSERT(validate_inode_children(_children));
+	namespace internals {
 
-				return true;
-			}
+		////////////////////////////////////////////		biased_rc
 
-			//	Counts the children actually used = skips trailing any null children.
-			public: size_t count_children() const{
-				STEADY_ASSERT(check_invariant());
+		/*
+			Each thread that makes biased_thread nodes gets one record. Nodes point to the record of the thread
+			that made them, their owner, until their counts are merged.
+
+			_queue: nodes owned by this thread whose shared count has gone negative, waiting for the owner to merge
+			their counts. Linked using biased_rc::_next_queued.
+			_exited: the thread has exited. Its nodes can now be merged by any thread.
+			_owners: one per node that names this record as _owner, plus one for the thread while it runs and one for
+			each thread busy queuing a node. Whoever takes it to 0 deletes the record.
+		*/
+		//	Number of live records, for tests.
+		inline std::atomic<int>& get_biased_record_count(){
+			static std::atomic<int> count{ 0 };
+			return count;
+		}
 
-				size_t index = 0;
-				while(index < _children.size() && _children[index].get_type() != node_type::null_node){
-					index++;
-				}
-				return index;
+		struct biased_thread_record {
+			public: biased_thread_record(){
+				get_biased_record_count()++;
 			}
 
-			//	Returns entire array, even if not all items are used.
-			public: children_t get_child_array() const{
-				STEADY_ASSERT(check_invariant());
-
-				return _children;
+			public: ~biased_thread_record(){
+				get_biased_record_count()--;
 			}
 
-			public: const node_ref<T>& get_child(size_t index) const{
-				STEADY_ASSERT(check_invariant());
-				STEADY_ASSERT(index < BRANCHING_FACTOR);
-				STEADY_ASSERT(index < _children.size());
-
-				return _children[index];
-			}
+			public: std::atomic<struct biased_rc*> _queue{ nullptr };
+			public: std::atomic<bool> _exited{ false };
+			public: std::atomic<int32_t> _owners{ 1 };
+		};
 
-			//	You can only call this for leaf nodes.
-			public: const leaf_node<T>* get_child_as_leaf_node(size_t index) const{
-				STEADY_ASSERT(check_invariant());
-				STEADY_ASSERT(index < _children.size());
-				STEADY_ASSERT(_children[0].get_type() == node_type::leaf_node);
+		inline void retain_biased_record(biased_thread_record* record){
+			record->_owners.fetch_add(1, std::memory_order_relaxed);
+		}
 
-				return _children[index]._leaf_node;
+		inline void release_biased_record(biased_thread_record* record, int32_t count = 1){
+			if(record->_owners.fetch_sub(count, std::memory_order_acq_rel) == count){
+				delete record;
 			}
+		}
 
+		//	The calling thread's record, nullptr if it hasn't made any biased nodes yet - or has exited.
+		inline biased_thread_record*& get_biased_record_slot(){
+			static thread_local biased_thread_record* record = nullptr;
+			return record;
+		}
 
-			//////////////////////////////	State
-
-			public: std::atomic<int32_t> _rc;
-			public: children_t _children;
-			public: static int _debug_count;
-		};
-
-		template <class T>
-		int inode<T>::_debug_count = 0;
+		inline bool& get_biased_thread_exited(){
+			static thread_local bool exited = false;
+			return exited;
+		}
 
+		/*
+			Reference counter of biased_thread nodes.
 
+			The owner thread counts in _biased, without locked instructions. All other threads count in _shared,
+			which is atomic. A node is alive as long as _biased + count in _shared > 0. _shared holds the count
+			times ONE, plus the flags MERGED and QUEUED.
 
+			When _biased gets to 0, the owner merges: the node gets unowned and from then on everybody uses _shared.
+			When the shared count goes negative - another thread releases a reference that the owner counted - the
+			node is queued to the owner thread which merges the counts the next time it releases a node, or when it
+			exits. Whoever takes _shared to exactly MERGED, zero references, deletes the node. If the owner gets to 0
+			while another thread is queuing the node, the node keeps its _owner until the queue is merged.
+		*/
+		struct biased_rc {
+			public: static const int32_t MERGED = 1;
+			public: static const int32_t QUEUED = 2;
+			public: static const int32_t ONE = 4;
+
+			public: inline biased_rc(int32_t count);
+			public: inline ~biased_rc();
+
+			//	Approximate total count, for asserts and tracing.
+			public: operator int32_t() const{
+				const auto shared = _shared.load(std::memory_order_relaxed);
+				return _biased.load(std::memory_order_relaxed) + (shared - (shared & (ONE - 1))) / ONE;
+			}
 
-		////////////////////////////////////////////		node_ref<T>
+			private: biased_rc(const biased_rc& rhs);
+			private: biased_rc& operator=(const biased_rc& rhs);
 
-		template <typename T>
-		struct node_ref {
-			public: node_ref();
 
-			public: node_ref(inode<T>* node);
-			public: node_ref(leaf_node<T>* node);
+			//////////////////////////////	State
 
-			public: node_ref(const node_ref<T>& ref);
+			public: std::atomic<biased_thread_record*> _owner;
 
-			public: ~node_ref();
+			//	Only touched by the owner thread. Atomic only to allow relaxed reads from asserts, no locked instructions.
+			public: std::atomic<int32_t> _biased;
+			public: std::atomic<int32_t> _shared;
 
-			public: bool check_invariant() const;
+			//	Used while queued to the owner thread.
+			public: biased_rc* _next_queued;
+			public: void* _node;
+			public: void (*_delete_node)(void* node);
+		};
 
-			public: void swap(node_ref<T>& rhs);
-			public: node_ref<T>& operator=(const node_ref<T>& rhs);
-			
-			public: node_type get_type() const;
-			public: inline const inode<T>* get_inode() const;
-			public: inline const leaf_node<T>* get_leaf_node() const;
-			public: inline leaf_node<T>* get_leaf_node();
+		//	Merges the counts of all nodes queued to _record_. Run by the owner thread or, after it exited, by anybody.
+		inline void merge_biased_queue(biased_thread_record* record){
+			auto rc = record->_queue.exchange(nullptr, std::memory_order_acquire);
+			int32_t merged_count = 0;
+			while(rc != nullptr){
+				const auto next = rc->_next_queued;
+				const auto biased = rc->_biased.load(std::memory_order_relaxed);
+				rc->_biased.store(0, std::memory_order_relaxed);
+				rc->_owner.store(nullptr, std::memory_order_relaxed);
+
+				auto shared = rc->_shared.load(std::memory_order_relaxed);
+				int32_t merged = 0;
+				do {
+					merged = (shared + biased * biased_rc::ONE - biased_rc::QUEUED) | biased_rc::MERGED;
+				} while(!rc->_shared.compare_exchange_weak(shared, merged, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+				if(merged == biased_rc::MERGED){
+					dispose_node(rc->_node, rc->_delete_node);
+				}
+				rc = next;
+				merged_count++;
+			}
 
-			///////////////////////////////////////		State
+			//	The record is not used after this: it may be deleted.
+			if(merged_count > 0){
+				release_biased_record(record, merged_count);
+			}
+		}
 
-			public: inode<T>* _inode;
-			public: leaf_node<T>* _leaf_node;
+		//	Hands the queued nodes of an exiting thread over to the other threads.
+		struct biased_thread_exit {
+			public: ~biased_thread_exit(){
+				auto record = get_biased_record_slot();
+				get_biased_record_slot() = nullptr;
+				get_biased_thread_exited() = true;
+				if(record != nullptr){
+					record->_exited.store(true);
+					merge_biased_queue(record);
+					release_biased_record(record);
+				}
+			}
 		};
 
-	}	//	Internals
+		inline biased_thread_record* make_biased_record(){
+			auto& record = get_biased_record_slot();
+			if(record == nullptr && !get_biased_thread_exited()){
+				static thread_local biased_thread_exit exit_hook;
+				(void)exit_hook;
+				record = new biased_thread_record();
+			}
+			return record;
+		}
 
+		//	New nodes are owned by the calling thread, or unowned if it is exiting.
+		biased_rc::biased_rc(int32_t count) :
+			_owner(make_biased_record()),
+			_biased(_owner.load() != nullptr ? count : 0),
+			_shared(_owner.load() != nullptr ? 0 : count * ONE + MERGED),
+			_next_queued(nullptr),
+			_node(nullptr),
+			_delete_node(nullptr)
+		{
+			const auto owner = _owner.load(std::memory_order_relaxed);
+			if(owner != nullptr){
+				retain_biased_record(owner);
+			}
+		}
 
+		//	Merged nodes have no owner. Only a node whose construction failed still has one.
+		biased_rc::~biased_rc(){
+			const auto owner = _owner.load(std::memory_order_relaxed);
+			if(owner != nullptr){
+				release_biased_record(owner);
+			}
+		}
 
+		/*
+			True if _me_ counts the node in _biased. A node that the owner merged while another thread was queuing it
+			keeps its _owner until the queue is merged, but the owner no longer counts it.
+		*/
+		inline bool is_biased_owner(const biased_rc& rc, const biased_thread_record* me){
+			return me != nullptr
+				&& rc._owner.load(std::memory_order_relaxed) == me
+				&& (rc._shared.load(std::memory_order_relaxed) & biased_rc::MERGED) == 0;
+		}
 
-////////////////////////////////////////////		vector
+		//	Queues _node_, whose shared count this thread took negative and marked QUEUED, to its owner.
+		template <class NODE>
+		void queue_biased_node(NODE* node){
+			auto& rc = node->_rc;
+			rc._node = node;
+			rc._delete_node = &delete_node<NODE>;
+
+			//	Once queued the node can be merged and the record deleted at any time: hold it until done.
+			const auto owner = rc._owner.load(std::memory_order_relaxed);
+			retain_biased_record(owner);
+			auto head = owner->_queue.load(std::memory_order_relaxed);
+			do {
+				rc._next_queued = head;
+			} while(!owner->_queue.compare_exchange_weak(head, &rc, std::memory_order_release, std::memory_order_relaxed));
+
+			if(owner->_exited.load()){
+				merge_biased_queue(owner);
+			}
+			release_biased_record(owner);
+		}
 
-/*
-	Persistent vector class.
-*/
+	}	//	internals
 
-template <class T>
-class vector {
-	public: typedef T value_type;
-	public: typedef std::size_t size_type;
 
-	public: vector();
-	public: vector(const std::vector<T>& values);
-	public: vector(const T values[], size_t count);
-	public: vector(std::initializer_list<T> args);
-	public: ~vector();
+	/*
+		Biased reference counting: the thread that makes a node updates its count without locked instructions,
+		other threads use an atomic count. Faster than multi_thread when most copying and releasing of nodes happens
+		on the thread that made them, as with vectors built and edited by one thread and now and then handed to
+		others. Each node is 36 bytes bigger than with multi_thread.
 
-	public: bool check_invariant() const;
+		Not for one vector that many threads copy and release: they all use the atomic count, and releasing it
+		takes a compare-and-swap loop instead of one subtract, so that is slower than multi_thread.
+	*/
+	struct biased_thread {
+		typedef internals::biased_rc rc_t;
+
+		template <class NODE> static void retain(NODE* node){
+			auto& rc = node->_rc;
+			const auto me = internals::get_biased_record_slot();
+			if(internals::is_biased_owner(rc, me)){
+				rc._biased.store(rc._biased.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+			else{
+				rc._shared.fetch_add(rc_t::ONE, std::memory_order_relaxed);
+			}
+		}
 
-	public: vector(const vector& rhs);
-	public: vector& operator=(const vector& rhs);
-	public: void swap(vector& rhs);
-	public: vector store(size_t index, const T& value) const;
-	public: vector store(size_t index, T&& value) const;
-	public: vector push_back(const T& value) const;
-	public: vector push_back(T&& value) const;
-	public: vector push_back(const std::vector<T>& values) const;
-	public: vector push_back(const T values[], size_t count) const;
+		//	Only sure when the owner holds the one reference, or the counts are merged. Queued counts answer false.
+		template <class NODE> static bool is_unique(const NODE* node){
+			const auto& rc = node->_rc;
+			const auto me = internals::get_biased_record_slot();
+			const auto shared = rc._shared.load(std::memory_order_acquire);
+			if(internals::is_biased_owner(rc, me)){
+				return rc._biased.load(std::memory_order_relaxed) == 1 && shared == 0;
+			}
+			else{
+				return shared == rc_t::ONE + rc_t::MERGED;
+			}
+		}
 
-	public: vector pop_back() const;
-
-	public: bool operator==(const vector& rhs) const;
-	public: bool operator!=(const vector& rhs) const{
-		return !(*this == rhs);
-	}
+		template <class NODE> static void release(NODE* node){
+			auto& rc = node->_rc;
+			const auto me = internals::get_biased_record_slot();
+			if(internals::is_biased_owner(rc, me)){
+				const auto biased = rc._biased.load(std::memory_order_relaxed) - 1;
+				rc._biased.store(biased, std::memory_order_relaxed);
+				if(biased == 0){
+					const auto shared = rc._shared.fetch_add(rc_t::MERGED, std::memory_order_acq_rel);
+
+					//	Another thread has claimed queuing the node and may not have read _owner yet: merging the
+					//	queue unowns the node instead. Else the thread's own count keeps the record.
+					if((shared & rc_t::QUEUED) == 0){
+						rc._owner.store(nullptr, std::memory_order_relaxed);
+						internals::release_biased_record(me);
+					}
+					if(shared + rc_t::MERGED == rc_t::MERGED){
+						internals::dispose_node(node);
+					}
+				}
+				if(me->_queue.load(std::memory_order_relaxed) != nullptr){
+					internals::merge_biased_queue(me);
+				}
+			}
+			else{
+				//	Decrement and, if this makes the count of an owned node negative, claim queuing it - in one step.
+				auto shared = rc._shared.load(std::memory_order_relaxed);
+				int32_t next = 0;
+				bool queue = false;
+				do {
+					next = shared - rc_t::ONE;
+					queue = next < 0 && (next & (rc_t::MERGED | rc_t::QUEUED)) == 0;
+					if(queue){
+						next |= rc_t::QUEUED;
+					}
+				} while(!rc._shared.compare_exchange_weak(shared, next, std::memory_order_acq_rel, std::memory_order_relaxed));
 
-	public: std::size_t size() const;
+				if(next == rc_t::MERGED){
+					internals::dispose_node(node);
+				}
+				else if(queue){
+					internals::queue_biased_node(node);
+				}
+			}
+		}
+	};
 
-	public: bool empty() const{
-		return size() == 0;
-	}
 
-	public: const T& operator[](std::size_t index) const;
+	////////////////////////////////////////////		allocator_i
 
-	public: std::vector<T> to_vec() const;
+	/*
+		Hook for the memory of the nodes: every leaf node, inode and size table of every vector<T, RC> is allocated and
+		freed through the allocator set with set_allocator(). Without one, the node pools are used.
 
-	public: size_t get_block_count() const;
-	public: const T* get_block(size_t block_index) const;
+		Memory is freed using the allocator that is set at that time, so only change allocator when there are no
+		nodes from the old allocator left - or when the new allocator forwards to the old one.
+		The allocator is called from all threads that use vectors.
+	*/
+	class allocator_i {
+		public: virtual ~allocator_i(){};
 
+		//	Returns memory for _size_ bytes, aligned for any type, or throws std::bad_alloc.
+		public: virtual void* allocator_i__allocate(std::size_t size) = 0;
 
-	///////////////////////////////////////		Internals
+		//	_p_ is memory from allocator_i__allocate() of the same _size_.
+		public: virtual void allocator_i__deallocate(void* p, std::size_t size) = 0;
+	};
 
-	/*
-		Traces a diagram of the structure of the vector using TRACE.
-	*/
-	public: void trace_internals() const;
 
-	public: const internals::node_ref<T>& get_root() const{
-		return _root;
-	}
-	public: vector(internals::node_ref<T> root, std::size_t size, int shift);
+	//	Uses ::operator new and ::operator delete. Handy to forward to from a custom allocator.
+	class heap_allocator : public allocator_i {
+		public: virtual void* allocator_i__allocate(std::size_t size){
+			return ::operator new(size);
+		}
 
-	public: int get_shift() const;
+		public: virtual void allocator_i__deallocate(void* p, std::size_t size){
+			(void)size;
+			::operator delete(p);
+		}
+	};
 
 
-	///////////////////////////////////////		State
+	namespace internals {
+		inline std::atomic<allocator_i*>& get_allocator_hook(){
+			static std::atomic<allocator_i*> hook(nullptr);
+			return hook;
+		}
+	}
 
-	private: internals::node_ref<T> _root;
-	private: std::size_t _size = 0;
+	//	Returns the allocator set by set_allocator() or nullptr if nodes come from the node pools.
+	inline allocator_i* get_allocator(){
+		return internals::get_allocator_hook().load();
+	}
 
-	//	This is the number of shift-steps needed to get to root.
-	//	It can be calculated from _size but that is slow so we cache it.
-	private: int _shift = internals::EMPTY_TREE_SHIFT;
-};
+	//	Makes all nodes come from _allocator_, or from the node pools if _allocator_ is nullptr. Returns the previous one.
+	inline allocator_i* set_allocator(allocator_i* allocator){
+		return internals::get_allocator_hook().exchange(allocator);
+	}
 
 
+	////////////////////////////////////////////		inline_capacity
 
-////////////////////////////////////////////		Global functions
+	/*
+		Vectors of up to inline_capacity<T>::value values keep them inside the vector object instead of in a leaf
+		node: making, copying and reading them allocates nothing and touches no reference counters. The first
+		push_back() past that moves the values to a leaf node.
 
+		Off - 0 - by default. Turn it on for your T by specializing, for example:
 
-template <class T>
-vector<T> operator+(const vector<T>& a, const vector<T>& b);
+			namespace steady {
+				template <> struct inline_capacity<my_pixel> { static const std::size_t value = 4; };
+			}
 
+		Each vector object grows by value * sizeof(T) bytes. T must be nothrow copy constructible. Pointers from
+		get_block() and iterators into an inline vector point into the vector object itself.
+	*/
+	template <class T>
+	struct inline_capacity {
+		static const std::size_t value = 0;
+	};
 
-//	For diagnosics and demo purposes.
-template <class T> size_t get_inode_count();
-template <class T> size_t get_leaf_count();
 
+	namespace internals {
 
+		//	Raw storage for the inline values of a vector. The vector tracks how many are constructed.
+		template <class T, std::size_t N>
+		struct inline_values {
+			public: T* get_inline_values(){
+				return reinterpret_cast<T*>(&_inline_storage[0]);
+			}
+			public: const T* get_inline_values() const{
+				return reinterpret_cast<const T*>(&_inline_storage[0]);
+			}
 
+			private: typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type _inline_storage[N];
+		};
 
+		//	No inline values: empty, so it adds nothing to the size of the vector.
+		template <class T>
+		struct inline_values<T, 0> {
+			public: T* get_inline_values(){
+				return nullptr;
+			}
+			public: const T* get_inline_values() const{
+				return nullptr;
+			}
+		};
+	}
 
-////////////////////////////////////////////		IMPLEMENTATION
 
 	namespace internals {
+		template <typename T, typename RC = multi_thread> struct node_ref;
+		template <typename T, typename RC = multi_thread> struct inode;
+		template <typename T, typename RC = multi_thread> struct leaf_node;
 
+		static const size_t BRANCHING_FACTOR_MASK = (BRANCHING_FACTOR - 1);
 
-		/*
-			Traces simple graph of the nodes in the tree.
-		*/
-		template <class T>
-		void trace_node(const std::string& prefix, const internals::node_ref<T>& node){
-			if(node.get_type() == internals::node_type::null_node){
-				STEADY_TRACE_SS(prefix << "<null>");
-			}
-			else if(node.get_type() == internals::node_type::inode){
-				std::stringstream s;
-				s << prefix << "<inode> RC: " << node.get_inode()->_rc;
-				STEADY_SCOPED_TRACE(s.str());
+		static const int EMPTY_TREE_SHIFT = -BRANCHING_FACTOR_SHIFT;
+		static const int LEAF_NODE_SHIFT = 0;
+		static const int LOWEST_LEVEL_INODE_SHIFT = BRANCHING_FACTOR_SHIFT;
 
-				int index = 0;
-				for(auto i: node.get_inode()->get_child_array()){
-					trace_node("#" + std::to_string(index) + "\t", i);
-					index++;
-				}
-			}
-			else if(node.get_type() == internals::node_type::leaf_node){
-				std::stringstream s;
-				s << prefix << "<leaf> RC: " << node.get_leaf_node()->_rc;
-				STEADY_SCOPED_TRACE(s.str());
 
-				int index = 0;
-				for(auto i: node.get_leaf_node()->_values){
-					STEADY_TRACE_SS("#" << std::to_string(index) << "\t" << i);
-					(void)i;
-					index++;
-				}
-			}
-			else{
-				STEADY_ASSERT(false);
-			}
-		}
+		////////////////////////////////////////////		edit_t
 
 		/*
-			Validates the list, not that the children är valid.
+			Identifies one edit session of a vector<T, RC>::transient. Nodes created by a transient are tagged with its
+			edit token and the transient is then free to mutate them in place.
+			0 = NO_EDIT: node belongs to persistent vectors and must never be mutated.
 		*/
-		template <class T>
-		bool validate_inode_children(const std::array<node_ref<T>, BRANCHING_FACTOR>& vec){
-			STEADY_ASSERT(vec.size() >= 0);
-			STEADY_ASSERT(vec.size() <= BRANCHING_FACTOR);
+		typedef std::uint64_t edit_t;
 
-			/*
-			for(auto i: vec){
-				i.check_invariant();
-			}
-			*/
+		static const edit_t NO_EDIT = 0;
 
-			if(vec.size() > 0){
-				const auto type = vec[0].get_type();
-				if(type == node_type::null_node){
-					for(const auto& i: vec){
-						STEADY_ASSERT(i.get_type() == node_type::null_node);
-					}
-				}
-				else if(type == node_type::inode){
-					size_t i = 0;
-					while(i < vec.size() && vec[i].get_type() == node_type::inode){
-						i++;
-					}
-					while(i < vec.size()){
-						STEADY_ASSERT(vec[i].get_type() == node_type::null_node);
-						i++;
-					}
-				}
-				else if(type == node_type::leaf_node){
-					size_t i = 0;
-					while(i < vec.size() && vec[i].get_type() == node_type::leaf_node){
-						i++;
-					}
-					while(i < vec.size()){
-						STEADY_ASSERT(vec[i].get_type() == node_type::null_node);
-						i++;
-					}
-				}
-				else{
-					STEADY_ASSERT(false);
-				}
-			}
-			return true;
-		}
+		//	Each thread takes a block of tokens at a time, so making a token is normally not a locked instruction.
+		static const edit_t EDIT_TOKEN_BLOCK = 1024;
 
+		inline edit_t new_edit_token(){
+			static std::atomic<edit_t> next(1);
+			static thread_local edit_t block_next = 0;
+			static thread_local edit_t block_end = 0;
 
-		template <class T>
-		node_ref<T> make_leaf_node(const std::array<T, BRANCHING_FACTOR>& values){
-			return node_ref<T>(new leaf_node<T>(values));
+			if(block_next == block_end){
+				block_next = next.fetch_add(EDIT_TOKEN_BLOCK);
+				block_end = block_next + EDIT_TOKEN_BLOCK;
+			}
+			return block_next++;
 		}
 
-		template <class T>
-		node_ref<T> make_leaf_node(T&& first_value){
-			auto leafnode = new leaf_node<T>();
-			leafnode->_values[0] = std::move(first_value);
-			return node_ref<T>(leafnode);
-		}
 
-		template <class T>
-		node_ref<T> make_inode_from_vector(const std::vector<node_ref<T>>& children){
-			STEADY_ASSERT(children.size() <= BRANCHING_FACTOR);
+		////////////////////////////////////////////		node_type
 
-			std::array<node_ref<T>, BRANCHING_FACTOR> temp{};
-			std::copy(children.begin(), children.end(), temp.begin());
-			return node_ref<T>(new inode<T>(temp));
-		}
+		enum class node_type {
+			null_node = 4,
+			inode,
+			leaf_node
+		};
 
 
-		template <class T>
-		node_ref<T> make_inode_from_array(const std::array<node_ref<T>, BRANCHING_FACTOR>& children){
-			return node_ref<T>(new inode<T>(children));
-		}
+		////////////////////////////////////////////		Utility functions
 
 
 		/*
-			Verifies the tree is valid.
-			### improve
+			### To be documented.
 		*/
-		template <class T>
-		bool tree_check_invariant(const node_ref<T>& tree, size_t size){
-			STEADY_ASSERT(tree.check_invariant());
-		#if STEADY_ASSERT_ON
-			if(size == 0){
-				STEADY_ASSERT(tree.get_type() == node_type::null_node);
-			}
-			else{
-				STEADY_ASSERT(tree.get_type() != node_type::null_node);
-			}
-		#endif
-			return true;
+		inline size_t divide_round_up(size_t value, size_t align){
+			const auto r = value / align;
+			return r * align < value ? r + 1 : r;
 		}
 
+		/*
+			Returns how deep node hiearchy is for a tree with *count* values. Counts both leaf-nodes and inodes.
+			0: empty
+			1: one leaf node.
+			2: one inode with 1-4 leaf nodes.
+			3: two levels of inodes plus leaf nodes.
+		*/
+		inline int count_to_depth(size_t count){
+			const auto leaf_count = divide_round_up(count, BRANCHING_FACTOR);
 
-		template <class T>
-		node_ref<T> find_leaf_node(const vector<T>& original, size_t index){
-			STEADY_ASSERT(original.check_invariant());
-			STEADY_ASSERT(index < original.size());
-
-			auto shift = original.get_shift();
-			node_ref<T> node_it = original.get_root();
-
-			//	Traverse all inodes.
-			while(shift > 0){
-				size_t slot_index = (index >> shift) & BRANCHING_FACTOR_MASK;
-				node_it = node_it.get_inode()->get_child(slot_index);
-				shift -= BRANCHING_FACTOR_SHIFT;
+			if(leaf_count == 0){
+				return 0;
+			}
+			else if(leaf_count == 1){
+				return 1;
+			}
+			else {
+				return 1 + count_to_depth(leaf_count);
 			}
-
-			STEADY_ASSERT(shift == LEAF_NODE_SHIFT);
-			STEADY_ASSERT(node_it.get_type() == node_type::leaf_node);
-			return node_it;
 		}
 
-
 		/*
-			node: original tree. Not changed by function. Cannot be null node, only inode or leaf node.
-
-			shift: shift for current level in tree.
-			leaf_index0: index of the first value in the leaf.
-			new_leaf: new leaf node.
-			result: copy of "tree" that has new_leaf replaced. Same size as original.
-				result-tree and original tree shares internal state.
+			Given a shift value, how many values can this tree hold without introduce more levels of inodes?
 		*/
-		template <class T>
-		node_ref<T> replace_leaf_node(const node_ref<T>& node, int shift, size_t leaf_index0, const node_ref<T>& new_leaf){
-			STEADY_ASSERT(node.get_type() == node_type::inode || node.get_type() == node_type::leaf_node);
-			STEADY_ASSERT(new_leaf.check_invariant());
+		inline size_t shift_to_max_size(int shift){
+			const size_t size = BRANCHING_FACTOR << shift;
+			return size;
+		}
 
-			const size_t slot_index = (leaf_index0 >> shift) & BRANCHING_FACTOR_MASK;
+		/*
+			Return how many steps to shift vector-index to get its *top-level* bits.
 
-			if(shift == LEAF_NODE_SHIFT){
-				STEADY_ASSERT(node.get_type() == node_type::leaf_node);
+			-BRANCHING_FACTOR_SHIFT: empty tree
+			0: leaf-node level
+			BRANCHING_FACTOR_SHIFT: inode1 (inode that points to leafnodes)
+			>=BRANCHING_FACTOR_SHIFT: inode that points to inodes.
+		*/
+		inline int vector_size_to_shift(size_t size){
+			const int shift = (count_to_depth(size) - 1) * BRANCHING_FACTOR_SHIFT;
+			return shift;
+		}
 
-				return new_leaf;
-			}
-			else{
-				STEADY_ASSERT(node.get_type() == node_type::inode);
 
-				const auto child = node.get_inode()->get_child(slot_index);
-				auto child2 = replace_leaf_node(child, shift - BRANCHING_FACTOR_SHIFT, leaf_index0, new_leaf);
 
-				auto children = node.get_inode()->get_child_array();
-				children[slot_index] = child2;
-				auto copy = make_inode_from_array(children);
-				return copy;
-			}
-		}
 
+		////////////////////////////////////////////		node_pool
 
 		/*
-			Recursively finds the correct leaf node and replaces the value _value_ with it. Returns new tree.
+			Nodes are small, have fixed sizes and are allocated and freed all the time, so they don't come from the
+			heap one at a time. There is one node_pool per block size. inode<T, RC> has the same size for every T, so all
+			inodes share one pool. Leaf nodes for types of the same size share a pool too.
 
-			node: original tree. Not changed by function. Cannot be null node, only inode or leaf node.
-			shift: shift for current level in tree.
-			index: entry to store "value" to.
-			value: value to store.
-			result: copy of "tree" that has "value" stored. Same size as original.
-				result-tree and original tree shares internal state.
+			Each thread keeps its own list of free blocks for each pool. Allocating and freeing a node is a couple of
+			pointer operations without atomics, also when the node was made by another thread. Free blocks move between
+			threads in magazines of NODE_POOL_MAGAZINE_SIZE blocks, through the depot of the pool which is a lock-free
+			stack. The blocks are never given back to the heap.
+
+			#define STEADY_NODE_POOL 0 to allocate each node using the heap, for tools like valgrind.
 		*/
 
-		template <class T>
-		node_ref<T> replace_value(const node_ref<T>& node, int shift, size_t index, const T& value){
-			STEADY_ASSERT(node.get_type() == node_type::inode || node.get_type() == node_type::leaf_node);
+		#ifndef STEADY_NODE_POOL
+			#define STEADY_NODE_POOL 1
+		#endif
 
-			const size_t slot_index = (index >> shift) & BRANCHING_FACTOR_MASK;
-			if(shift == LEAF_NODE_SHIFT){
-				STEADY_ASSERT(node.get_type() == node_type::leaf_node);
+		static const size_t NODE_POOL_MAGAZINE_SIZE = 64;
 
-				auto copy = node_ref<T>(new leaf_node<T>(node.get_leaf_node()->_values));
+		//	Overlays a free block. Only the first block of a magazine uses _next_magazine and _count.
+		struct free_block {
+			public: free_block* _next;
+			public: free_block* _next_magazine;
+			public: size_t _count;
+		};
 
-				STEADY_ASSERT(slot_index < copy.get_leaf_node()->_values.size());
-				copy.get_leaf_node()->_values[slot_index] = value;
+		//	Rounded up so blocks carved out of one heap allocation stay aligned, and so similar sizes share a pool.
+		constexpr size_t node_pool_block_size(size_t size){
+			return (size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+		}
 
-				return copy;
+		class node_pool {
+			public: explicit node_pool(size_t block_size) :
+				_block_size(block_size),
+				_depot(nullptr),
+				_heap_block_count(0),
+				_depot_block_count(0),
+				_magazine_exchange_count(0),
+				_next_pool(nullptr)
+			{
+				STEADY_ASSERT(block_size >= sizeof(free_block));
+				STEADY_ASSERT(block_size % alignof(std::max_align_t) == 0);
+
+				//	Register in the list of all pools.
+				auto head = get_pools().load();
+				do {
+					_next_pool = head;
+				} while(!get_pools().compare_exchange_weak(head, this));
 			}
-			else{
-				STEADY_ASSERT(node.get_type() == node_type::inode);
-
-				const auto child = node.get_inode()->get_child(slot_index);
-				auto child2 = replace_value(child, shift - BRANCHING_FACTOR_SHIFT, index, value);
 
-				auto children = node.get_inode()->get_child_array();
-				children[slot_index] = child2;
-				auto copy = make_inode_from_array(children);
-				return copy;
+			//	Never destroyed, there can be nodes left that are freed during static destruction.
+			public: static std::atomic<node_pool*>& get_pools(){
+				static std::atomic<node_pool*> pools(nullptr);
+				return pools;
 			}
-		}
-		template <class T>
-		node_ref<T> replace_value(const node_ref<T>& node, int shift, size_t index, T&& value){
-			STEADY_ASSERT(node.get_type() == node_type::inode || node.get_type() == node_type::leaf_node);
-
-			const size_t slot_index = (index >> shift) & BRANCHING_FACTOR_MASK;
-			if(shift == LEAF_NODE_SHIFT){
-				STEADY_ASSERT(node.get_type() == node_type::leaf_node);
-
-				auto copy = node_ref<T>(new leaf_node<T>(node.get_leaf_node()->_values));
 
-				STEADY_ASSERT(slot_index < copy.get_leaf_node()->_values.size());
-				copy.get_leaf_node()->_values[slot_index] = std::move(value);
+			//	Pushes a magazine of _head_->_count blocks to the depot.
+			public: void put_magazine(free_block* head){
+				STEADY_ASSERT(head != nullptr && head->_count > 0);
 
-				return copy;
+				_depot_block_count += head->_count;
+				_magazine_exchange_count++;
+				push_magazines(head, head);
 			}
-			else{
-				STEADY_ASSERT(node.get_type() == node_type::inode);
-
-				const auto child = node.get_inode()->get_child(slot_index);
-				auto child2 = replace_value(child, shift - BRANCHING_FACTOR_SHIFT, index, std::move(value));
 
-				auto children = node.get_inode()->get_child_array();
-				children[slot_index] = child2;
-				auto copy = make_inode_from_array(children);
-				return copy;
-			}
-		}
+			/*
+				Pops one magazine from the depot, or returns nullptr if the depot is empty.
+				Popping a single node from a lock-free stack suffers from the ABA-problem, so this takes the entire
+				stack, keeps the first magazine and pushes back the rest. The rest is put back as it is while the depot
+				is still empty, so only when other threads pushed meanwhile do we walk it to find its end.
+			*/
+			public: free_block* take_magazine(){
+				auto head = _depot.exchange(nullptr, std::memory_order_acquire);
+				if(head == nullptr){
+					return nullptr;
+				}
+				else{
+					auto rest = head->_next_magazine;
+					free_block* expected = nullptr;
+					if(rest != nullptr && !_depot.compare_exchange_strong(expected, rest, std::memory_order_release, std::memory_order_relaxed)){
+						auto last = rest;
+						while(last->_next_magazine != nullptr){
+							last = last->_next_magazine;
+						}
+						push_magazines(rest, last);
+					}
+					head->_next_magazine = nullptr;
+					_depot_block_count -= head->_count;
+					_magazine_exchange_count++;
+					return head;
+				}
+			}
 
-		
-		/*
-			Creates a leaf node with zero to many parent inodes (all inodes only contain one item).
+			//	Allocates a magazine of new blocks from the heap, all in one allocation.
+			public: free_block* make_magazine(){
+				auto memory = static_cast<char*>(::operator new(_block_size * NODE_POOL_MAGAZINE_SIZE));
+				for(size_t i = 0 ; i < NODE_POOL_MAGAZINE_SIZE ; i++){
+					auto block = reinterpret_cast<free_block*>(memory + i * _block_size);
+					block->_next = i + 1 < NODE_POOL_MAGAZINE_SIZE ? reinterpret_cast<free_block*>(memory + (i + 1) * _block_size) : nullptr;
+				}
+				auto head = reinterpret_cast<free_block*>(memory);
+				head->_next_magazine = nullptr;
+				head->_count = NODE_POOL_MAGAZINE_SIZE;
+				_heap_block_count += NODE_POOL_MAGAZINE_SIZE;
+				return head;
+			}
 
-			Example path:
-				inode
-					inode
-						inode
-							leaf_node
+			public: node_pool_stats get_stats() const{
+				node_pool_stats result;
+				result._block_size = _block_size;
+				result._heap_block_count = _heap_block_count;
+				result._depot_block_count = _depot_block_count;
+				result._magazine_exchange_count = _magazine_exchange_count;
+				return result;
+			}
 
-			Example path:
-				inode
-					leaf_node
+			private: void push_magazines(free_block* first, free_block* last){
+				auto head = _depot.load(std::memory_order_relaxed);
+				do {
+					last->_next_magazine = head;
+				} while(!_depot.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+			}
 
-			Example path:
-				leaf_node
-		*/
-		template <class T>
-		node_ref<T> make_new_path(int shift, const node_ref<T>& leaf_node){
-			STEADY_ASSERT(leaf_node.check_invariant());
-			STEADY_ASSERT(leaf_node.get_type() == node_type::leaf_node);
+			private: node_pool(const node_pool& rhs);
+			private: node_pool& operator=(const node_pool& rhs);
 
-			if(shift == LEAF_NODE_SHIFT){
-				return leaf_node;
-			}
-			else{
-				auto a = make_new_path(shift - BRANCHING_FACTOR_SHIFT, leaf_node);
-				node_ref<T> b = make_inode_from_array<T>({ a });
-				return b;
-			}
-		}
 
-		/*
-			Adds the new leaf-node last in the tree. Returns new tree.
+			//////////////////////////////	State
 
-			original: original tree. Not changed by function. Cannot be null node, only inode or leaf node.
-			index: point to location of new leaf-mode = current number of values in tree.
-			value: value to store.
-			result: copy of "tree" that has "value" stored. Same size as original.
-				result-tree and original tree shares internal state
+			public: const size_t _block_size;
+			private: std::atomic<free_block*> _depot;
+			private: std::atomic<size_t> _heap_block_count;
+			private: std::atomic<size_t> _depot_block_count;
+			private: std::atomic<size_t> _magazine_exchange_count;
+			public: node_pool* _next_pool;
+		};
 
-			New tree may be same depth or +1 deep.
 
-			Cannot append node when root gets full!
+		/*
+			The pool for blocks of BLOCK_SIZE bytes and the calling thread's cache of free blocks for it.
+			The cache is plain thread_local pointers so it can still be used after the thread has begun exiting. When
+			the thread exits, _flusher hands its free blocks back to the depot.
 		*/
-		template <class T>
-		node_ref<T> append_leaf_node(const node_ref<T>& original, int shift, size_t index, const node_ref<T>& leaf_node){
-			STEADY_ASSERT(original.check_invariant());
-			STEADY_ASSERT(original.get_type() == node_type::inode);
-			STEADY_ASSERT(leaf_node.check_invariant());
-			STEADY_ASSERT(leaf_node.get_type() == node_type::leaf_node);
+		template <size_t BLOCK_SIZE>
+		struct node_pool_cache {
+			struct flusher {
+				public: ~flusher(){
+					flush(0);
+					_exited = true;
+				}
 
-			size_t slot_index = (index >> shift) & BRANCHING_FACTOR_MASK;
-			auto children = original.get_inode()->get_child_array();
+				public: bool _armed;
+			};
 
-			//	Lowest level inode, pointing to leaf nodes.
-			if(shift == LOWEST_LEVEL_INODE_SHIFT){
-				children[slot_index] = leaf_node;
-				return make_inode_from_array<T>(children);
+			public: static node_pool& get_pool(){
+				//	Allocated and never deleted: nodes can be freed by other threads during static destruction.
+				static node_pool* pool = new node_pool(BLOCK_SIZE);
+				return *pool;
 			}
-			else {
-				const auto child = children[slot_index];
-				if(child.get_type() == node_type::null_node){
-					node_ref<T> child2 = make_new_path(shift - BRANCHING_FACTOR_SHIFT, leaf_node);
-					children[slot_index] = child2;
-					return make_inode_from_array<T>(children);
+
+			public: static void* allocate(){
+				if(_exited){
+					return allocate_exited();
 				}
-				else{
-					node_ref<T> child2 = append_leaf_node(child, shift - BRANCHING_FACTOR_SHIFT, index, leaf_node);
-					children[slot_index] = child2;
-					return make_inode_from_array<T>(children);
+				if(_free == nullptr){
+					refill();
 				}
+				auto block = _free;
+				_free = block->_next;
+				_count--;
+				return block;
 			}
-		}
-
 
-		/*
-			Original must be a multiple of BRANCHING_FACTOR - no partial leaf node.
-		*/
-		template <class T>
-		vector<T> push_back_leaf_node(const vector<T>& original, const node_ref<T>& new_leaf, size_t leaf_item_count){
-			STEADY_ASSERT(original.check_invariant());
-			STEADY_ASSERT(new_leaf.check_invariant());
-			STEADY_ASSERT(new_leaf.get_type() == node_type::leaf_node);
-			STEADY_ASSERT((original.size() & BRANCHING_FACTOR_MASK) == 0);
-			STEADY_ASSERT(leaf_item_count <= BRANCHING_FACTOR);
+			public: static void deallocate(void* p){
+				STEADY_ASSERT(p != nullptr);
 
-			const auto original_size = original.size();
-			const auto original_shift = original.get_shift();
+				auto block = static_cast<free_block*>(p);
+				if(_exited){
+					block->_next = nullptr;
+					block->_count = 1;
+					get_pool().put_magazine(block);
+				}
+				else{
+					if(_free == nullptr){
+						_flusher._armed = true;
+					}
+					block->_next = _free;
+					_free = block;
+					_count++;
+					if(_count >= NODE_POOL_MAGAZINE_SIZE * 2){
+						flush(NODE_POOL_MAGAZINE_SIZE);
+					}
+				}
+			}
 
-			if(original_size == 0){
-				const auto result = vector<T>(new_leaf, leaf_item_count, LEAF_NODE_SHIFT);
-				STEADY_ASSERT(result.check_invariant());
-				return result;
+			private: static void refill(){
+				auto& pool = get_pool();
+				auto head = pool.take_magazine();
+				if(head == nullptr){
+					head = pool.make_magazine();
+				}
+				_free = head;
+				_count = head->_count;
+				_flusher._armed = true;
 			}
-			else{
-				//	How many values can we fit in tree with this shift-constant?
-				size_t max_values = internals::shift_to_max_size(original_shift);
-				bool fits_in_root = (original_size + leaf_item_count) <= max_values;
-
-				//	Space left in root?
-				if(fits_in_root){
-					const auto root = append_leaf_node(original.get_root(), original_shift, original_size, new_leaf);
-					const auto result = vector<T>(root, original_size + leaf_item_count, original_shift);
-					STEADY_ASSERT(result.check_invariant());
-					return result;
+
+			/*
+				The cache was flushed when the thread began exiting and nothing would flush it again: take one block
+				from a magazine and hand the rest straight back to the depot.
+			*/
+			private: static void* allocate_exited(){
+				auto& pool = get_pool();
+				auto head = pool.take_magazine();
+				if(head == nullptr){
+					head = pool.make_magazine();
 				}
-				else{
-					auto new_path = make_new_path(original_shift, new_leaf);
-					auto new_root = make_inode_from_array<T>({ original.get_root(), new_path });
-					const auto result = vector<T>(new_root, original_size + leaf_item_count, original_shift + BRANCHING_FACTOR_SHIFT);
-					STEADY_ASSERT(result.check_invariant());
-					return result;
+				auto rest = head->_next;
+				if(rest != nullptr){
+					rest->_count = head->_count - 1;
+					pool.put_magazine(rest);
+				}
+				return head;
+			}
+
+			//	Moves all but _keep_ of the free blocks to the depot, as one magazine.
+			private: static void flush(size_t keep){
+				if(_count > keep){
+					auto head = _free;
+					auto last = head;
+					for(size_t i = 1 ; i < _count - keep ; i++){
+						last = last->_next;
+					}
+					_free = last->_next;
+					last->_next = nullptr;
+					head->_count = _count - keep;
+					_count = keep;
+					get_pool().put_magazine(head);
 				}
 			}
-		}
 
+			private: static thread_local free_block* _free;
+			private: static thread_local size_t _count;
+			private: static thread_local bool _exited;
+			private: static thread_local flusher _flusher;
+		};
 
+		template <size_t BLOCK_SIZE>
+		thread_local free_block* node_pool_cache<BLOCK_SIZE>::_free = nullptr;
 
+		template <size_t BLOCK_SIZE>
+		thread_local size_t node_pool_cache<BLOCK_SIZE>::_count = 0;
 
-		template <class T>
-		vector<T> push_back_1(const vector<T>& original, const T& value) {
-			STEADY_ASSERT(original.check_invariant());
-			const auto size = original.size();
-			//	Does last leaf node have space for one more value? Then we use replace_value() - keeping tree same size.
-			if((size & BRANCHING_FACTOR_MASK) != 0){
-				const auto shift = original.get_shift();
-				const auto root = replace_value(original.get_root(), shift, size, value);
-				return vector<T>(root, size + 1, shift);
-			}
-			else {
-				const auto leaf = make_leaf_node<T>({ value });
-				return push_back_leaf_node(original, leaf, 1);
+		template <size_t BLOCK_SIZE>
+		thread_local bool node_pool_cache<BLOCK_SIZE>::_exited = false;
+
+		template <size_t BLOCK_SIZE>
+		thread_local typename node_pool_cache<BLOCK_SIZE>::flusher node_pool_cache<BLOCK_SIZE>::_flusher;
+
+
+		//	All memory for nodes comes from here: the allocator hook if there is one, else the node pools.
+		template <size_t SIZE>
+		void* allocate_node_block(){
+			const auto allocator = get_allocator_hook().load(std::memory_order_relaxed);
+			if(allocator != nullptr){
+				return allocator->allocator_i__allocate(SIZE);
 			}
+		#if STEADY_NODE_POOL
+			return node_pool_cache<node_pool_block_size(SIZE)>::allocate();
+		#else
+			return ::operator new(SIZE);
+		#endif
 		}
 
-		template <class T>
-		vector<T> push_back_1(const vector<T>& original, T&& value) {
-			STEADY_ASSERT(original.check_invariant());
-			const auto size = original.size();
-			//	Does last leaf node have space for one more value? Then we use replace_value() - keeping tree same size.
-			if((size & BRANCHING_FACTOR_MASK) != 0) {
-				const auto shift = original.get_shift();
-				const auto root = replace_value(original.get_root(), shift, size, std::forward<T>(value));
-				return vector<T>(root, size + 1, shift);
-			}
-			else {
-				const auto leaf = make_leaf_node<T>(std::move( value ));
-				return push_back_leaf_node(original, leaf, 1);
+		template <size_t SIZE>
+		void deallocate_node_block(void* p){
+			const auto allocator = get_allocator_hook().load(std::memory_order_relaxed);
+			if(allocator != nullptr){
+				allocator->allocator_i__deallocate(p, SIZE);
+				return;
 			}
+		#if STEADY_NODE_POOL
+			node_pool_cache<node_pool_block_size(SIZE)>::deallocate(p);
+		#else
+			::operator delete(p);
+		#endif
 		}
 
-		/*
-			This is the central building block: adds many values to a vector (or a create a new vector) fast.
-		*/
-#if 0
-		template <class T>
-		vector<T> push_back_batch(const vector<T>& original, const T values[], size_t count){
-			STEADY_ASSERT(original.check_invariant());
-			STEADY_ASSERT(values != nullptr);
 
-			vector<T> result = original;
-			for(size_t i = 0 ; i < count ; i++){
-				result = result.push_back(values[i]);
-			}
-			return result;
-		}
 
-#else
 
-		template <class T>
-		vector<T> push_back_batch(const vector<T>& original, const T values[], std::size_t count){
-			STEADY_ASSERT(original.check_invariant());
-			STEADY_ASSERT(values != nullptr);
+		////////////////////////////////////////////		value_ops
 
-			vector<T> result = original;
-			size_t source_pos = 0;
+		/*
+			Pointer to values that are copied, or moved for MOVE. Functions that can do both take a MOVE template
+			parameter that defaults to copying, and pass std::integral_constant<bool, MOVE>() on to value_ops.
+		*/
+		template <class T, bool MOVE>
+		using source_t = typename std::conditional<MOVE, T, const T>::type*;
 
-			/*
-				1) If the last leaf node in destination is partially filled, pad it out.
-			*/
-			{
-				size_t last_leaf_size = original.size() & BRANCHING_FACTOR_MASK;
-				if(last_leaf_size > 0){
-					size_t last_leaf_node_index = original.size() & ~(BRANCHING_FACTOR_MASK);
-#if 0
-					size_t copy_count = std::min(BRANCHING_FACTOR - last_leaf_size, count);
-					for(size_t i = 0 ; i < copy_count ; i++){
-						result = push_back_1(result, values[source_pos]);
-						source_pos++;
-					}
-#else
-					size_t copy_count = std::min(BRANCHING_FACTOR - last_leaf_size, count);
-					node_ref<T> prev_leaf = find_leaf_node(result, last_leaf_node_index);
-					node_ref<T> new_leaf_node(new leaf_node<T>());
-
-					//	Copy existing values.
-					std::copy(&prev_leaf.get_leaf_node()->_values[0],
-						&prev_leaf.get_leaf_node()->_values[last_leaf_size],
-						new_leaf_node.get_leaf_node()->_values.begin());
-
-					//	Append our new values.
-					std::copy(&values[source_pos],
-						&values[source_pos + copy_count],
-						new_leaf_node.get_leaf_node()->_values.begin() + last_leaf_size);
-
-					node_ref<T> new_root = replace_leaf_node(result.get_root(), result.get_shift(), last_leaf_node_index, new_leaf_node);
-					result = vector<T>(new_root, result.size() + copy_count, result.get_shift());
-					source_pos += copy_count;
+		/*
+			Copying, destructing and comparing runs of values, for example all values of a leaf node.
 
-#endif
-				}
+			value_ops<T, false> works value by value. The specialization value_ops<T, true> is used for trivially
+			copyable types - int, float, pixel structs - and copies with one memcpy() and skips destruction. This
+			doesn't depend on the optimizer spotting the loops.
+		*/
+		template <class T, bool TRIVIAL = std::is_trivially_copyable<T>::value>
+		struct value_ops {
+			//	Copy-constructs _count_ values into raw memory. If a copy throws, the ones made are destructed.
+			static void construct_copies(T* dest, const T source[], size_t count){
+				std::uninitialized_copy(&source[0], &source[count], dest);
 			}
 
 			/*
-				Append _entire leaf nodes_ while there are enough source values. Includes appending a last, partial leaf.
+				Like construct_copies() but moves the values out of _source_, which the caller gives up. Types whose
+				move constructor can throw are copied instead, so a throw leaves _source_ as it was.
 			*/
-			if(source_pos < count){
-				while(source_pos < count){
-					STEADY_ASSERT((result.size() & BRANCHING_FACTOR_MASK) == 0);
-
-					auto new_leaf_node = node_ref<T>(new leaf_node<T>());
-					const size_t batch_count = std::min(count - source_pos, static_cast<std::size_t>(BRANCHING_FACTOR));
-
-					std::copy(&values[source_pos],
-						&values[source_pos + batch_count],
-						new_leaf_node.get_leaf_node()->_values.begin());
+			static void construct_moves(T* dest, T source[], size_t count){
+				size_t i = 0;
+				try {
+					for(; i < count ; i++){
+						::new (static_cast<void*>(dest + i)) T(std::move_if_noexcept(source[i]));
+					}
+				}
+				catch(...){
+					destroy(dest, i);
+					throw;
+				}
+			}
 
-					result = internals::push_back_leaf_node(result, new_leaf_node, batch_count);
+			static void construct(T* dest, const T source[], size_t count, std::false_type){
+				construct_copies(dest, source, count);
+			}
+			static void construct(T* dest, T source[], size_t count, std::true_type){
+				construct_moves(dest, source, count);
+			}
 
-					source_pos += batch_count;
+			static void destroy(T values[], size_t count){
+				for(size_t i = 0 ; i < count ; i++){
+					values[i].~T();
 				}
 			}
+		};
 
-			STEADY_ASSERT(result.check_invariant());
-			STEADY_ASSERT(result.size() == original.size() + count);
-			return result;
-		}
-#endif
+		template <class T>
+		struct value_ops<T, true> {
+			static void construct_copies(T* dest, const T source[], size_t count){
+				if(count > 0){
+					std::memcpy(static_cast<void*>(dest), static_cast<const void*>(source), sizeof(T) * count);
+				}
+			}
 
+			static void construct_moves(T* dest, T source[], size_t count){
+				construct_copies(dest, source, count);
+			}
 
+			static void construct(T* dest, const T source[], size_t count, std::false_type){
+				construct_copies(dest, source, count);
+			}
+			static void construct(T* dest, T source[], size_t count, std::true_type){
+				construct_copies(dest, source, count);
+			}
 
+			static void destroy(T values[], size_t count){
+				(void)values;
+				(void)count;
+			}
+		};
 
-		////////////////////////////////////////////		node_ref<T>
 
 		/*
-			Safe, reference counted handle that holds either an inode, a LeadNode or null.
+			Finds the first of _count_ values where _a_ and _b_ differ, returns _count_ if none.
+
+			value_compare<T, true> first compares the whole run with one memcmp(), which is how most runs are
+			compared: equal. Only used for types where operator==() means equal bits - integers, enums and pointers.
+			Not for floats: 0.0f == -0.0f but NaN != NaN. Not for structs: padding bytes.
 		*/
+		template <class T, bool BITWISE = std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>
+		struct value_compare {
+			static size_t mismatch(const T a[], const T b[], size_t count){
+				return std::mismatch(&a[0], &a[count], &b[0]).first - &a[0];
+			}
+		};
 
-		template <typename T>
-		node_ref<T>::node_ref() :
-			_inode(nullptr),
-			_leaf_node(nullptr)
-		{
-			STEADY_ASSERT(check_invariant());
-		}
+		template <class T>
+		struct value_compare<T, true> {
+			static size_t mismatch(const T a[], const T b[], size_t count){
+				if(count == 0 || std::memcmp(static_cast<const void*>(a), static_cast<const void*>(b), sizeof(T) * count) == 0){
+					return count;
+				}
+				return std::mismatch(&a[0], &a[count], &b[0]).first - &a[0];
+			}
+		};
 
 		/*
-			Will assume ownership of the input node - caller must not delete it after call returns.
-			Adds ref.
-			node == nullptr => null_node
+			Like value_compare, but finds the first values that are not equivalent: a < b or b < a. Used by operator<()
+			so it only needs T::operator<() and gives the same result as std::lexicographical_compare(), also where
+			== and < disagree. Two NaNs are equivalent, for example.
 		*/
-		template <typename T>
-		node_ref<T>::node_ref(inode<T>* node) :
-			_inode(nullptr),
-			_leaf_node(nullptr)
-		{
-			if(node != nullptr){
-				STEADY_ASSERT(node->check_invariant());
-				STEADY_ASSERT(node->_rc >= 0);
-
-				_inode = node;
-				_inode->_rc++;
+		template <class T, bool BITWISE = std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>
+		struct value_order {
+			static size_t mismatch(const T a[], const T b[], size_t count){
+				for(size_t i = 0 ; i < count ; i++){
+					if(a[i] < b[i] || b[i] < a[i]){
+						return i;
+					}
+				}
+				return count;
 			}
+		};
+
+		//	For these types equivalent means equal bits.
+		template <class T>
+		struct value_order<T, true> : public value_compare<T, true> {
+		};
+
 
-			STEADY_ASSERT(check_invariant());
-		}
+
+		////////////////////////////////////////////		leaf_node
 
 		/*
-			Will assume ownership of the input node - caller must not delete it after call returns.
-			Adds ref.
-			node == nullptr => null_node
+			This object holds a number of values, of type T.
+			These nodes live at the bottom of an inode tree.
+
+			Holds an intrusive reference counter that is used by client code.
+
+			_used tells how many of the values, counted from the start, have been handed out to some vector.
+			The values above _used are not part of any vector yet, so push_back() on the vector whose tail
+			ends exactly at _used can claim the next value atomically and construct it in place, instead of
+			copying the leaf node.
+
+			The values are kept in raw storage: only the _used first values are constructed. This saves default
+			constructing and destructing the unused values and T needs no default constructor.
+
+			_capacity tells how many values the leaf node has memory for. The tails of small vectors are made just big
+			enough and grow geometrically when pushed to, by copying to a leaf node twice the size. This way a vector
+			of 3 values costs about 3 values, not BRANCHING_FACTOR.
 		*/
-		template <typename T>
-		node_ref<T>::node_ref(leaf_node<T>* node) :
-			_inode(nullptr),
-			_leaf_node(nullptr)
-		{
-			if(node != nullptr){
-				STEADY_ASSERT(node->check_invariant());
-				STEADY_ASSERT(node->_rc >= 0);
 
-				_leaf_node = node;
-				_leaf_node->_rc++;
+		//	Smallest leaf node capacity - 1, 2, 4 ... BRANCHING_FACTOR - that fits _count_ values.
+		inline size_t leaf_capacity(size_t count){
+			STEADY_ASSERT(count <= BRANCHING_FACTOR);
+
+			size_t result = 1;
+			while(result < count){
+				result *= 2;
 			}
+			return result;
+		}
 
-			STEADY_ASSERT(check_invariant());
+		/*
+			Capacity for a new tail leaf node holding _count_ values. Vectors without a tree are small: their tails
+			grow geometrically. Vectors with a tree get a full sized tail right away.
+		*/
+		inline size_t tail_capacity(size_t tree_size, size_t count){
+			return tree_size == 0 ? leaf_capacity(count) : BRANCHING_FACTOR;
 		}
 
-		//	Uses reference counting to share all state.
-		template <typename T>
-		node_ref<T>::node_ref(const node_ref<T>& ref) :
-			_inode(nullptr),
-			_leaf_node(nullptr)
-		{
-			STEADY_ASSERT(ref.check_invariant());
+		template <class T, class RC>
+		struct leaf_node {
+			//	Atomic or plain reference counter, depending on the policy RC.
+			public: typedef typename RC::rc_t rc_t;
+			public: typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type value_storage_t;
+
+			/*
+				Makes an empty leaf node with room for _capacity_ values, see leaf_capacity(). Only the memory for
+				those values is allocated: the block is cut short after them.
+			*/
+			public: static leaf_node* make(size_t capacity){
+				STEADY_ASSERT(capacity == leaf_capacity(capacity));
 
-			if(ref.get_type() == node_type::null_node){
+				return ::new (allocate_block<1>(capacity)) leaf_node(capacity);
 			}
-			else if(ref.get_type() == node_type::inode){
-				_inode = ref._inode;
-				_inode->_rc++;
+
+			public: static leaf_node* make(const std::array<T, BRANCHING_FACTOR>& values){
+				auto result = make(BRANCHING_FACTOR);
+				try {
+					result->append(values.data(), BRANCHING_FACTOR);
+				}
+				catch(...){
+					destroy(result);
+					throw;
+				}
+				return result;
 			}
-			else if(ref.get_type() == node_type::leaf_node){
-				_leaf_node = ref._leaf_node;
-				_leaf_node->_rc++;
+
+			//	Use instead of delete.
+			public: static void destroy(leaf_node* node){
+				const auto capacity = static_cast<size_t>(node->_capacity);
+				node->~leaf_node();
+				deallocate_block<1>(node, capacity);
 			}
-			else{
-				STEADY_ASSERT(false);
+
+			//	Bytes used by a leaf node with room for _capacity_ values.
+			public: static constexpr size_t block_size(size_t capacity){
+				return sizeof(leaf_node) - (BRANCHING_FACTOR - capacity) * sizeof(value_storage_t);
 			}
 
-			STEADY_ASSERT(check_invariant());
-		}
+			private: explicit leaf_node(size_t capacity) :
+				_rc(0),
+				_used(0),
+				_capacity(static_cast<int16_t>(capacity)),
+				_edit(NO_EDIT)
+			{
+				_debug_count++;
+				STEADY_ASSERT(check_invariant());
+			}
 
-		template <typename T>
-		node_ref<T>::~node_ref(){
-			STEADY_ASSERT(check_invariant());
+			public: ~leaf_node(){
+				STEADY_ASSERT(check_invariant());
+				STEADY_ASSERT(_rc == 0);
 
-			if(get_type() == node_type::null_node){
+				destroy_values(0, _used);
+				_debug_count--;
 			}
-			else if(get_type() == node_type::inode){
-				_inode->_rc--;
-				if(_inode->_rc == 0){
-					delete _inode;
-					_inode = nullptr;
-				}
+
+			public: bool check_invariant() const {
+				STEADY_ASSERT(_rc >= 0);
+				STEADY_ASSERT(_rc < 1000);
+				STEADY_ASSERT(_capacity > 0 && _capacity == static_cast<int16_t>(leaf_capacity(_capacity)));
+				STEADY_ASSERT(_used >= 0 && _used <= _capacity);
+				return true;
 			}
-			else if(get_type() == node_type::leaf_node){
-				_leaf_node->_rc--;
-				if(_leaf_node->_rc == 0){
-					delete _leaf_node;
-					_leaf_node = nullptr;
-				}
+
+			//	Points to value 0. Only the first _used values are constructed.
+			public: T* get_values(){
+				return reinterpret_cast<T*>(&_storage[0]);
 			}
-			else{
-				STEADY_ASSERT(false);
+
+			public: const T* get_values() const{
+				return reinterpret_cast<const T*>(&_storage[0]);
 			}
-		}
 
-		template <typename T>
-		bool node_ref<T>::check_invariant() const {
-			STEADY_ASSERT(_inode == nullptr || _leaf_node == nullptr);
+			/*
+				Constructs copies of _count_ values after the used values, or moves them for MOVE. Only for leaf nodes
+				that no other vector can see yet. If a copy throws, the leaf node is left as it was.
+			*/
+			public: template <bool MOVE = false> void append(source_t<T, MOVE> values, size_t count){
+				const auto used = static_cast<size_t>(_used);
+				STEADY_ASSERT(used + count <= static_cast<size_t>(_capacity));
 
-			if(_inode != nullptr){
-				STEADY_ASSERT(_inode->check_invariant());
-				STEADY_ASSERT(_inode->_rc > 0);
-			}
-			else if(_leaf_node != nullptr){
-				STEADY_ASSERT(_leaf_node->check_invariant());
-				STEADY_ASSERT(_leaf_node->_rc > 0);
+				value_ops<T>::construct(get_values() + used, values, count, std::integral_constant<bool, MOVE>());
+				_used = static_cast<int16_t>(used + count);
 			}
-			return true;
-		}
 
-		template <typename T>
-		void node_ref<T>::swap(node_ref<T>& rhs){
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(rhs.check_invariant());
+			//	Like append(), for one value constructed from _args_.
+			public: template <class... ARGS> void push(ARGS&&... args){
+				const auto used = static_cast<size_t>(_used);
+				STEADY_ASSERT(used < static_cast<size_t>(_capacity));
 
-			std::swap(_inode, rhs._inode);
-			std::swap(_leaf_node, rhs._leaf_node);
+				new (get_values() + used) T(std::forward<ARGS>(args)...);
+				_used = static_cast<int16_t>(used + 1);
+			}
 
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(rhs.check_invariant());
-		}
+			//	Destructs the last used value. Only for leaf nodes that no other vector uses.
+			public: void pop(){
+				const auto used = static_cast<size_t>(_used);
+				STEADY_ASSERT(used > 0);
 
-		template <typename T>
-		node_ref<T>& node_ref<T>::operator=(const node_ref<T>& rhs){
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(rhs.check_invariant());
+				_used = static_cast<int16_t>(used - 1);
+				destroy_values(used - 1, used);
+			}
 
-			node_ref<T> temp(rhs);
+			//	Destructs the values from _count_ and on. Only for leaf nodes that no other vector uses.
+			public: void truncate(size_t count){
+				const auto used = static_cast<size_t>(_used);
+				STEADY_ASSERT(count <= used);
 
-			temp.swap(*this);
+				_used = static_cast<int16_t>(count);
+				destroy_values(count, used);
+			}
 
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(rhs.check_invariant());
-			return *this;
-		}
+			public: void destroy_values(size_t begin, size_t end){
+				value_ops<T>::destroy(get_values() + begin, end - begin);
+			}
 
-		template <typename T>
-		node_type node_ref<T>::get_type() const {
-			STEADY_ASSERT(_inode == nullptr || _leaf_node == nullptr);
+			/*
+				Claims the _count_ values starting at _pos_, if nobody has claimed them before and they fit.
+				Returns false if some other vector already uses those values or the leaf node is too small.
+				The claimer must then construct the values, or unclaim() them.
+			*/
+			public: bool claim(size_t pos, size_t count){
+				STEADY_ASSERT(pos + count <= BRANCHING_FACTOR);
 
-			if(_inode == nullptr && _leaf_node == nullptr){
-				return node_type::null_node;
+				if(pos + count > static_cast<size_t>(_capacity)){
+					return false;
+				}
+				int16_t expected = static_cast<int16_t>(pos);
+				return _used.compare_exchange_strong(expected, static_cast<int16_t>(pos + count));
 			}
-			else if(_inode != nullptr){
-				return node_type::inode;
+
+			//	Undoes a claim(). Only the one who made the claim can do this.
+			public: void unclaim(size_t pos, size_t count){
+				int16_t expected = static_cast<int16_t>(pos + count);
+				const auto ok = _used.compare_exchange_strong(expected, static_cast<int16_t>(pos));
+				STEADY_ASSERT(ok);
+				(void)ok;
 			}
-			else if(_leaf_node != nullptr){
-				return node_type::leaf_node;
+
+			//	Each capacity has a node pool of its own. CAPACITY steps 1, 2, 4 ... up to _capacity_.
+			private: template <size_t CAPACITY> static void* allocate_block(size_t capacity){
+				STEADY_ASSERT(capacity <= BRANCHING_FACTOR);
+
+				return capacity == CAPACITY
+					? allocate_node_block<block_size(CAPACITY)>()
+					: allocate_block<(CAPACITY < BRANCHING_FACTOR ? CAPACITY * 2 : CAPACITY)>(capacity);
+			}
+
+			private: template <size_t CAPACITY> static void deallocate_block(void* p, size_t capacity){
+				STEADY_ASSERT(capacity <= BRANCHING_FACTOR);
+
+				if(capacity == CAPACITY){
+					deallocate_node_block<block_size(CAPACITY)>(p);
+				}
+				else{
+					deallocate_block<(CAPACITY < BRANCHING_FACTOR ? CAPACITY * 2 : CAPACITY)>(p, capacity);
+				}
+			}
+
+			//	Blocks can be shorter than the object: always use make() and destroy().
+			private: static void* operator new(std::size_t size);
+			private: static void operator delete(void* p);
+
+			private: leaf_node<T, RC>& operator=(const leaf_node& rhs);
+			private: leaf_node(const leaf_node& rhs);
+
+
+			//////////////////////////////	State
+
+			public: rc_t _rc;
+			public: std::atomic<int16_t> _used;
+
+			//	Number of values there is memory for, 1, 2, 4 ... BRANCHING_FACTOR.
+			public: int16_t _capacity;
+			public: edit_t _edit;
+
+			//	Must be last.
+			public: value_storage_t _storage[BRANCHING_FACTOR];
+			public: static int _debug_count;
+		};
+
+		template <class T, class RC>
+		int leaf_node<T, RC>::_debug_count = 0;
+
+
+
+		////////////////////////////////////////////		inode
+
+		/*
+			An inode is used to hold leaf nodes when more than one leaf node is needed. It can also hold other inodes.
+
+			An inode has these states:
+				full set of iNode pointers or
+				full set of leaf node pointers or
+				empty vector.
+
+			You cannot mix sub-inode and sub-leaf nodes in the same inode.
+			inode pointers and leaf node pointers can be null, but the nulls are always at the end of the arrays.
+
+			Holds an intrusive reference counter that is used by client code.
+
+			An inode is either regular or relaxed (RRB-tree). In a regular inode all children except the last one are
+			full, so the child holding a value is found using the bits of the index. A relaxed inode also has a
+			size table that tells how many values there are in its children, cumulative. Concatenation makes relaxed
+			nodes along the seam.
+		*/
+
+		template <class T, class RC>
+		struct inode {
+			public: typedef typename RC::rc_t rc_t;
+			public: typedef std::array<node_ref<T, RC>, BRANCHING_FACTOR> children_t;
+			public: typedef std::array<size_t, BRANCHING_FACTOR> sizes_t;
+
+			//	children: 0-32 children, all of the same type. kNullNodes can only appear at end of vector.
+			public: explicit inode(const children_t& children2) :
+				_rc(0),
+				_edit(NO_EDIT),
+				_children(children2),
+				_sizes(nullptr)
+			{
+		#if STEADY_ASSERT_ON
+				for(const auto& i: _children){
+					i.check_invariant();
+				}
+		#endif
+
+				_debug_count++;
+				STEADY_ASSERT(check_invariant());
+			}
+
+			//	Moves the children in instead of copying them.
+			public: explicit inode(children_t&& children2) :
+				_rc(0),
+				_edit(NO_EDIT),
+				_children(std::move(children2)),
+				_sizes(nullptr)
+			{
+		#if STEADY_ASSERT_ON
+				for(const auto& i: _children){
+					i.check_invariant();
+				}
+		#endif
+
+				_debug_count++;
+				STEADY_ASSERT(check_invariant());
+			}
+
+			//	Makes a relaxed inode. sizes[i] is the number of values in children 0 to i. Unused entries are ignored.
+			public: inode(const children_t& children2, const sizes_t& sizes) :
+				_rc(0),
+				_edit(NO_EDIT),
+				_children(children2),
+				_sizes(new (allocate_node_block<sizeof(sizes_t)>()) sizes_t(sizes))
+			{
+		#if STEADY_ASSERT_ON
+				for(const auto& i: _children){
+					i.check_invariant();
+				}
+		#endif
+
+				_debug_count++;
+				STEADY_ASSERT(check_invariant());
+			}
+
+			public: inode(children_t&& children2, const sizes_t& sizes) :
+				_rc(0),
+				_edit(NO_EDIT),
+				_children(std::move(children2)),
+				_sizes(new (allocate_node_block<sizeof(sizes_t)>()) sizes_t(sizes))
+			{
+		#if STEADY_ASSERT_ON
+				for(const auto& i: _children){
+					i.check_invariant();
+				}
+		#endif
+
+				_debug_count++;
+				STEADY_ASSERT(check_invariant());
+			}
+
+
+			public: ~inode(){
+				STEADY_ASSERT(check_invariant());
+				STEADY_ASSERT(_rc == 0);
+
+				if(_sizes != nullptr){
+					deallocate_node_block<sizeof(sizes_t)>(_sizes);
+					_sizes = nullptr;
+				}
+				_debug_count--;
+			}
+
+			/*
+				Use instead of new. Constructs the inode in a block from the node pool. A new-expression would inline
+				the pool's operator delete into its cleanup path, and GCC warns about that code reading the
+				uninitialized inode.
+			*/
+			public: template <class... ARGS> static inode* make(ARGS&&... args){
+				const auto block = allocate_node_block<sizeof(inode)>();
+				try {
+					return ::new (block) inode(std::forward<ARGS>(args)...);
+				}
+				catch(...){
+					deallocate_node_block<sizeof(inode)>(block);
+					throw;
+				}
+			}
+
+			//	Only for delete-expressions on inodes from make().
+			public: static void operator delete(void* p){
+				deallocate_node_block<sizeof(inode)>(p);
+			}
+			private: static void* operator new(std::size_t size);
+
+			private: inode<T, RC>& operator=(const inode& rhs);
+			private: inode(const inode& rhs);
+
+			public: bool check_invariant() const {
+				STEADY_ASSERT(_rc >= 0);
+				STEADY_ASSERT(_rc < 10000);
+				STEADY_ASSERT(validate_inode_children(_children));
+
+				return true;
+			}
+
+			//	Counts the children actually used = skips trailing any null children.
+			public: size_t count_children() const{
+				STEADY_ASSERT(check_invariant());
+
+				size_t index = 0;
+				while(index < _children.size() && _children[index].get_type() != node_type::null_node){
+					index++;
+				}
+				return index;
+			}
+
+			//	Returns entire array, even if not all items are used.
+			public: const children_t& get_child_array() const{
+				STEADY_ASSERT(check_invariant());
+
+				return _children;
+			}
+
+			public: const node_ref<T, RC>& get_child(size_t index) const{
+				STEADY_ASSERT(check_invariant());
+				STEADY_ASSERT(index < BRANCHING_FACTOR);
+				STEADY_ASSERT(index < _children.size());
+
+				return _children[index];
+			}
+
+			//	You can only call this for leaf nodes.
+			public: const leaf_node<T, RC>* get_child_as_leaf_node(size_t index) const{
+				STEADY_ASSERT(check_invariant());
+				STEADY_ASSERT(index < _children.size());
+				STEADY_ASSERT(_children[0].get_type() == node_type::leaf_node);
+
+				return _children[index].get_leaf_node();
+			}
+
+
+			//////////////////////////////	State
+
+			public: rc_t _rc;
+			public: edit_t _edit;
+			public: children_t _children;
+
+			//	nullptr: regular inode.
+			public: sizes_t* _sizes;
+			public: static int _debug_count;
+		};
+
+		template <class T, class RC>
+		int inode<T, RC>::_debug_count = 0;
+
+
+
+
+		////////////////////////////////////////////		node_ref<T, RC>
+
+		template <typename T, typename RC>
+		struct node_ref {
+			public: node_ref();
+
+			public: node_ref(inode<T, RC>* node);
+			public: node_ref(leaf_node<T, RC>* node);
+
+			public: node_ref(const node_ref<T, RC>& ref);
+
+			//	Takes over the reference of _ref_, which becomes a null node. No reference counting.
+			public: node_ref(node_ref<T, RC>&& ref) noexcept;
+
+			public: ~node_ref();
+
+			public: bool check_invariant() const;
+
+			public: void swap(node_ref<T, RC>& rhs);
+			public: node_ref<T, RC>& operator=(const node_ref<T, RC>& rhs);
+			public: node_ref<T, RC>& operator=(node_ref<T, RC>&& rhs) noexcept;
+			
+			public: node_type get_type() const;
+
+			//	Like a std::shared_ptr, a const node_ref doesn't make the node const.
+			public: inline inode<T, RC>* get_inode() const;
+			public: inline leaf_node<T, RC>* get_leaf_node() const;
+
+			///////////////////////////////////////		State
+
+			/*
+				Tagged pointer to the inode or leaf node, 0 for null_node. Nodes are at least 8-byte aligned, so the
+				lowest bit is free: it is set for leaf nodes. This keeps node_ref the size of one pointer, which
+				halves the size of the children array of an inode.
+			*/
+			public: static const std::uintptr_t LEAF_NODE_TAG = 1;
+			public: std::uintptr_t _ptr;
+		};
+
+	}	//	Internals
+
+
+
+
+////////////////////////////////////////////		vector
+
+/*
+	Persistent vector class.
+*/
+
+template <class T, class RC = multi_thread>
+class vector : private internals::inline_values<T, inline_capacity<T>::value> {
+	public: typedef T value_type;
+	public: typedef std::size_t size_type;
+
+	//	Max number of values kept inside the vector object, see inline_capacity.
+	public: static const std::size_t INLINE_CAPACITY = inline_capacity<T>::value;
+
+	static_assert(INLINE_CAPACITY <= BRANCHING_FACTOR, "inline_capacity must fit in one leaf node");
+	static_assert(INLINE_CAPACITY == 0 || std::is_nothrow_copy_constructible<T>::value, "Inline values must be nothrow copy constructible");
+
+	public: vector();
+	public: vector(const std::vector<T>& values);
+
+	//	Moves the values out of _values_ instead of copying them.
+	public: vector(std::vector<T>&& values);
+	public: vector(const T values[], size_t count);
+	public: vector(std::initializer_list<T> args);
+
+	/*
+		Copies the values of a vector that uses another reference counting policy. The new vector shares no nodes
+		with _rhs_: this is how a vector<T, single_thread> is handed to other threads.
+	*/
+	public: template <class RC2> explicit vector(const vector<T, RC2>& rhs);
+	public: ~vector();
+
+	public: bool check_invariant() const;
+
+	public: vector(const vector& rhs);
+	public: vector& operator=(const vector& rhs);
+
+	/*
+		Takes over the nodes of _rhs_ without touching their reference counters. Inline values are copied.
+		_rhs_ becomes empty.
+	*/
+	public: vector(vector&& rhs) noexcept;
+	public: vector& operator=(vector&& rhs) noexcept;
+
+	public: void swap(vector& rhs);
+	public: vector store(size_t index, const T& value) const&;
+	public: vector store(size_t index, T&& value) const&;
+	public: vector push_back(const T& value) const&;
+	public: vector push_back(T&& value) const&;
+	public: vector push_back(const std::vector<T>& values) const&;
+	public: vector push_back(std::vector<T>&& values) const&;
+	public: vector push_back(const T values[], size_t count) const&;
+
+	//	Like push_back() but constructs the new value in place from _args_, without a temporary T.
+	public: template <class... ARGS> vector emplace_back(ARGS&&... args) const&;
+
+	public: vector pop_back() const&;
+
+	/*
+		Same as above, for a vector you are done with: v = std::move(v).push_back(x). The nodes that no other
+		vector uses are edited in place instead of copied, so editing a vector kept in one variable allocates
+		little and touches few reference counters. Shared nodes are copied like before, other vectors never see a change.
+		Afterwards this vector is valid but holds unspecified values. Iterators and views of it are invalidated.
+	*/
+	public: vector store(size_t index, const T& value) &&;
+	public: vector store(size_t index, T&& value) &&;
+	public: vector push_back(const T& value) &&;
+	public: vector push_back(T&& value) &&;
+	public: vector push_back(const std::vector<T>& values) &&;
+	public: vector push_back(std::vector<T>&& values) &&;
+	public: vector push_back(const T values[], size_t count) &&;
+	public: template <class... ARGS> vector emplace_back(ARGS&&... args) &&;
+
+	public: vector pop_back() &&;
+
+	/*
+		Returns the first _count_ values as a new vector. Shares all nodes it keeps with this vector.
+	*/
+	public: vector take(std::size_t count) const;
+
+	/*
+		Returns the vector without its first _count_ values. Leaf nodes and inodes that only hold dropped values
+		are released.
+	*/
+	public: vector drop_front(std::size_t count) const;
+
+	public: bool operator==(const vector& rhs) const;
+	public: bool operator!=(const vector& rhs) const{
+		return !(*this == rhs);
+	}
+
+	//	Lexicographic compare, like std::vector.
+	public: bool operator<(const vector& rhs) const;
+	public: bool operator>(const vector& rhs) const{
+		return rhs < *this;
+	}
+	public: bool operator<=(const vector& rhs) const{
+		return !(rhs < *this);
+	}
+	public: bool operator>=(const vector& rhs) const{
+		return !(*this < rhs);
+	}
+
+	public: std::size_t size() const;
+
+	public: bool empty() const{
+		return size() == 0;
+	}
+
+	public: const T& operator[](std::size_t index) const;
+
+	public: std::vector<T> to_vec() const;
+
+	/*
+		Returns the values [begin, end) as a new vector. O(log n), the new vector shares nodes with this one.
+		trim: false => the nodes before _begin_ are kept, just hidden. This is fastest.
+			true => nodes before the leaf node holding _begin_ are released, costing a path copy.
+	*/
+	public: vector subvec(std::size_t begin, std::size_t end, bool trim = false) const;
+
+	/*
+		Returns a pointer to the value at _index_ and the values after it in the same leaf node.
+		out_count: number of values readable from the returned pointer, always at least 1.
+	*/
+	public: const T* get_block(size_t index, size_t& out_count) const;
+
+	public: class transient;
+	public: class const_iterator;
+
+	public: const_iterator begin() const;
+	public: const_iterator end() const;
+
+
+	///////////////////////////////////////		Internals
+
+	/*
+		Traces a diagram of the structure of the vector using TRACE.
+	*/
+	public: void trace_internals() const;
+
+	public: const internals::node_ref<T, RC>& get_root() const{
+		return _root;
+	}
+	public: const internals::node_ref<T, RC>& get_tail() const{
+		return _tail;
+	}
+	public: vector(internals::node_ref<T, RC> root, int shift, std::size_t tree_size, internals::node_ref<T, RC> tail, std::size_t size, std::size_t offset);
+
+	public: int get_shift() const;
+	public: std::size_t get_tree_size() const;
+	public: std::size_t get_offset() const;
+
+	//	True if the values are kept inside the vector object. Then there is no tree and no tail.
+	public: bool is_inline() const{
+		return INLINE_CAPACITY > 0 && _size > 0 && _tail.get_type() == internals::node_type::null_node;
+	}
+
+	/*
+		Returns the same values with a tree and tail, never inline. Inline values are copied to a new tail leaf
+		node with room for _reserve_ values, or as many as fit in one leaf node.
+	*/
+	public: vector to_tree(std::size_t reserve = 0) const;
+
+	//	Copy-constructs _count_ values after the inline values, or moves them for MOVE. Only for empty or inline vectors.
+	private: template <bool MOVE = false> void append_inline(internals::source_t<T, MOVE> values, std::size_t count);
+	private: template <class... ARGS> vector push_back_inline(ARGS&&... args) const;
+	private: template <class U> vector store_inline(std::size_t index, U&& value) const;
+	private: template <class U> vector store_unique(std::size_t index, U&& value);
+	private: template <class... ARGS> vector push_back_unique(ARGS&&... args);
+	private: template <bool MOVE> vector push_back_values(internals::source_t<T, MOVE> values, std::size_t count) const;
+	private: template <bool MOVE> vector push_back_values_unique(internals::source_t<T, MOVE> values, std::size_t count);
+
+
+	///////////////////////////////////////		State
+
+	//	The tree holds all values except the last 1 - BRANCHING_FACTOR values. Trees made by push_back() only contain
+	//	full leaf nodes, concatenated trees can have partial leaf nodes in relaxed inodes.
+	private: internals::node_ref<T, RC> _root;
+
+	//	The last leaf node is kept out of the tree. push_back() fills it up and only moves it into the tree when it's full.
+	//	Null for empty and inline vectors.
+	private: internals::node_ref<T, RC> _tail;
+
+	//	Number of values in _root. The rest, _size + _offset - _tree_size, are in the tail.
+	private: std::size_t _tree_size = 0;
+
+	//	Number of values at the start of _root that are not part of this vector. Made by subvec().
+	//	Value _index_ of the vector is value _index_ + _offset of the tree. Always 0 when the tree is empty.
+	private: std::size_t _offset = 0;
+
+	private: std::size_t _size = 0;
+
+	//	This is the number of shift-steps needed to get to root.
+	//	It can be calculated from the size of the tree but that is slow so we cache it.
+	private: int _shift = internals::EMPTY_TREE_SHIFT;
+};
+
+
+
+////////////////////////////////////////////		vector::transient
+
+/*
+	Mutable builder for making many edits to a vector cheaply, then getting a persistent vector back.
+
+	The transient starts out sharing all nodes with the vector it is made from. The first edit of a node copies it
+	and tags the copy with the transient's edit token. Later edits of that node happen in place. N edits
+	then cost roughly N / BRANCHING_FACTOR leaf node copies plus one path per touched leaf node.
+
+	persistent() returns a vector holding the current values and ends the edit session: the nodes are now shared
+	with an immutable vector so the transient will copy them again before next edit.
+
+	A transient is a normal, mutable C++ object. It is not thread safe.
+*/
+
+template <class T, class RC>
+class vector<T, RC>::transient {
+	public: transient();
+	public: explicit transient(const vector<T, RC>& original);
+
+	public: bool check_invariant() const;
+
+	public: std::size_t size() const;
+	public: const T& operator[](std::size_t index) const;
+
+	public: void store(size_t index, const T& value);
+	public: void store(size_t index, T&& value);
+	public: void push_back(const T& value);
+	public: void push_back(T&& value);
+	public: template <class... ARGS> void emplace_back(ARGS&&... args);
+	public: void pop_back();
+
+	public: vector<T, RC> persistent();
+
+
+	///////////////////////////////////////		Internals
+
+	private: template <class U> void store_internal(size_t index, U&& value);
+	private: template <class... ARGS> void push_back_internal(ARGS&&... args);
+	private: transient(const transient& rhs);
+	private: transient& operator=(const transient& rhs);
+
+
+	///////////////////////////////////////		State
+
+	private: internals::node_ref<T, RC> _root;
+	private: internals::node_ref<T, RC> _tail;
+	private: std::size_t _tree_size = 0;
+	private: std::size_t _offset = 0;
+	private: std::size_t _size = 0;
+	private: int _shift = internals::EMPTY_TREE_SHIFT;
+	private: internals::edit_t _edit;
+};
+
+
+
+////////////////////////////////////////////		vector::const_iterator
+
+/*
+	STL random access iterator. Caches a pointer to the values of the current leaf node, so stepping through
+	the vector only walks the tree once every leaf node, not once every value.
+
+	The iterator points into the vector: the vector must outlive it.
+*/
+
+template <class T, class RC>
+class vector<T, RC>::const_iterator {
+	public: typedef std::random_access_iterator_tag iterator_category;
+	public: typedef T value_type;
+	public: typedef std::ptrdiff_t difference_type;
+	public: typedef const T* pointer;
+	public: typedef const T& reference;
+
+	public: const_iterator();
+	public: const_iterator(const vector<T, RC>* vec, std::size_t index);
+	public: bool check_invariant() const;
+
+	public: reference operator*() const;
+	public: pointer operator->() const;
+	public: reference operator[](difference_type n) const;
+
+	public: const_iterator& operator++();
+	public: const_iterator operator++(int);
+	public: const_iterator& operator--();
+	public: const_iterator operator--(int);
+	public: const_iterator& operator+=(difference_type n);
+	public: const_iterator& operator-=(difference_type n);
+	public: const_iterator operator+(difference_type n) const;
+	public: const_iterator operator-(difference_type n) const;
+	public: difference_type operator-(const const_iterator& rhs) const;
+	public: friend const_iterator operator+(difference_type n, const const_iterator& it){
+		return it + n;
+	}
+
+	public: bool operator==(const const_iterator& rhs) const{
+		return _index == rhs._index;
+	}
+	public: bool operator!=(const const_iterator& rhs) const{
+		return _index != rhs._index;
+	}
+	public: bool operator<(const const_iterator& rhs) const{
+		return _index < rhs._index;
+	}
+	public: bool operator>(const const_iterator& rhs) const{
+		return _index > rhs._index;
+	}
+	public: bool operator<=(const const_iterator& rhs) const{
+		return _index <= rhs._index;
+	}
+	public: bool operator>=(const const_iterator& rhs) const{
+		return _index >= rhs._index;
+	}
+
+
+	///////////////////////////////////////		Internals
+
+	//	Looks up the block holding _index_, unless we already have it.
+	private: void update_block();
+
+
+	///////////////////////////////////////		State
+
+	private: const vector<T, RC>* _vector = nullptr;
+	private: std::size_t _index = 0;
+
+	//	Values [_block_begin, _block_end) of the vector are at _block. Empty when not looked up yet.
+	private: const T* _block = nullptr;
+	private: std::size_t _block_begin = 0;
+	private: std::size_t _block_end = 0;
+};
+
+
+
+////////////////////////////////////////////		vector_view
+
+/*
+	Read-only window onto the values [begin, end) of a vector. It borrows the nodes of the vector instead of
+	owning them, so making, copying and reading a view never touches any reference counters. Use it to fan out
+	reads of a vector to many short tasks.
+
+	The view keeps raw pointers to the root and tail nodes, not to the vector object. It is valid as long as some
+	vector holds those nodes unchanged - the viewed vector can be reassigned or moved from meanwhile if a copy of
+	it lives on. Inline vectors are the exception: their values are inside the vector object, which the view then
+	points into.
+*/
+
+template <class T, class RC = multi_thread>
+class vector_view {
+	public: typedef T value_type;
+	public: typedef std::size_t size_type;
+	public: class const_iterator;
+
+	public: vector_view();
+	public: explicit vector_view(const vector<T, RC>& vec);
+	public: explicit vector_view(const vector<T, RC>& vec, std::size_t begin, std::size_t end);
+
+	//	A temporary vector would release the nodes while the view still points to them.
+	public: explicit vector_view(vector<T, RC>&& vec) = delete;
+	public: explicit vector_view(vector<T, RC>&& vec, std::size_t begin, std::size_t end) = delete;
+	public: bool check_invariant() const;
+
+	public: std::size_t size() const;
+	public: bool empty() const{
+		return size() == 0;
+	}
+
+	public: const T& operator[](std::size_t index) const;
+
+	//	Like vector::get_block(), but out_count stops at the end of the view.
+	public: const T* get_block(std::size_t index, std::size_t& out_count) const;
+
+	public: const_iterator begin() const;
+	public: const_iterator end() const;
+
+	//	Returns a view of the values [begin, end) of this view.
+	public: vector_view subview(std::size_t begin, std::size_t end) const;
+
+	//	Returns a vector with the values of the view. O(log n), shares nodes with the viewed vector.
+	public: vector<T, RC> to_vector() const;
+
+
+	///////////////////////////////////////		State
+
+	//	Borrowed from the vector. The root is an inode, or a leaf node when the tree is one leaf node.
+	private: internals::inode<T, RC>* _root_inode = nullptr;
+	private: internals::leaf_node<T, RC>* _root_leaf = nullptr;
+	private: internals::leaf_node<T, RC>* _tail = nullptr;
+
+	//	The values after the tree: those of _tail, or the inline values of the vector object.
+	private: const T* _tail_values = nullptr;
+
+	//	Same as in the vector.
+	private: std::size_t _tree_size = 0;
+	private: std::size_t _offset = 0;
+	private: int _shift = internals::EMPTY_TREE_SHIFT;
+	private: std::size_t _vector_size = 0;
+
+	//	The view is the values [_begin, _begin + _size) of the vector.
+	private: std::size_t _begin = 0;
+	private: std::size_t _size = 0;
+};
+
+
+
+////////////////////////////////////////////		vector_view::const_iterator
+
+/*
+	STL random access iterator, like vector::const_iterator. The iterator points into the view: the view must
+	outlive it.
+*/
+
+template <class T, class RC>
+class vector_view<T, RC>::const_iterator {
+	public: typedef std::random_access_iterator_tag iterator_category;
+	public: typedef T value_type;
+	public: typedef std::ptrdiff_t difference_type;
+	public: typedef const T* pointer;
+	public: typedef const T& reference;
+
+	public: const_iterator();
+	public: const_iterator(const vector_view<T, RC>* view, std::size_t index);
+	public: bool check_invariant() const;
+
+	public: reference operator*() const;
+	public: pointer operator->() const;
+	public: reference operator[](difference_type n) const;
+
+	public: const_iterator& operator++();
+	public: const_iterator operator++(int);
+	public: const_iterator& operator--();
+	public: const_iterator operator--(int);
+	public: const_iterator& operator+=(difference_type n);
+	public: const_iterator& operator-=(difference_type n);
+	public: const_iterator operator+(difference_type n) const;
+	public: const_iterator operator-(difference_type n) const;
+	public: difference_type operator-(const const_iterator& rhs) const;
+	public: friend const_iterator operator+(difference_type n, const const_iterator& it){
+		return it + n;
+	}
+
+	public: bool operator==(const const_iterator& rhs) const{
+		return _index == rhs._index;
+	}
+	public: bool operator!=(const const_iterator& rhs) const{
+		return _index != rhs._index;
+	}
+	public: bool operator<(const const_iterator& rhs) const{
+		return _index < rhs._index;
+	}
+	public: bool operator>(const const_iterator& rhs) const{
+		return _index > rhs._index;
+	}
+	public: bool operator<=(const const_iterator& rhs) const{
+		return _index <= rhs._index;
+	}
+	public: bool operator>=(const const_iterator& rhs) const{
+		return _index >= rhs._index;
+	}
+
+
+	///////////////////////////////////////		Internals
+
+	//	Looks up the block holding _index_, unless we already have it.
+	private: void update_block();
+
+
+	///////////////////////////////////////		State
+
+	private: const vector_view<T, RC>* _view = nullptr;
+	private: std::size_t _index = 0;
+
+	//	Values [_block_begin, _block_end) of the view are at _block. Empty when not looked up yet.
+	private: const T* _block = nullptr;
+	private: std::size_t _block_begin = 0;
+	private: std::size_t _block_end = 0;
+};
+
+
+
+////////////////////////////////////////////		Global functions
+
+
+template <class T, class RC>
+vector<T, RC> operator+(const vector<T, RC>& a, const vector<T, RC>& b);
+
+/*
+	Returns the index ranges [first, second) where _a_ and _b_ hold different values, in order. When the vectors
+	have different sizes, the values after the end of the shortest vector are one last range.
+	Nodes shared between the vectors are skipped: the cost grows with the size of the change, not of the vectors.
+*/
+template <class T, class RC>
+std::vector<std::pair<std::size_t, std::size_t>> diff(const vector<T, RC>& a, const vector<T, RC>& b);
+
+
+//	For diagnosics and demo purposes.
+template <class T> size_t get_inode_count();
+template <class T> size_t get_leaf_count();
+
+//	Returns the counters of all node pools that have been used so far, one per block size.
+inline std::vector<node_pool_stats> get_node_pool_stats();
+
+
+
+
+
+////////////////////////////////////////////		IMPLEMENTATION
+
+	namespace internals {
+
+
+		/*
+			Traces simple graph of the nodes in the tree.
+		*/
+		template <class T, class RC>
+		void trace_node(const std::string& prefix, const internals::node_ref<T, RC>& node){
+			if(node.get_type() == internals::node_type::null_node){
+				STEADY_TRACE_SS(prefix << "<null>");
+			}
+			else if(node.get_type() == internals::node_type::inode){
+				std::stringstream s;
+				s << prefix << "<inode> RC: " << node.get_inode()->_rc;
+				if(node.get_inode()->_sizes != nullptr){
+					s << " sizes:";
+					for(size_t i = 0 ; i < node.get_inode()->count_children() ; i++){
+						s << " " << (*node.get_inode()->_sizes)[i];
+					}
+				}
+				STEADY_SCOPED_TRACE(s.str());
+
+				int index = 0;
+				for(const auto& i: node.get_inode()->get_child_array()){
+					trace_node("#" + std::to_string(index) + "\t", i);
+					index++;
+				}
+			}
+			else if(node.get_type() == internals::node_type::leaf_node){
+				std::stringstream s;
+				s << prefix << "<leaf> RC: " << node.get_leaf_node()->_rc;
+				STEADY_SCOPED_TRACE(s.str());
+
+				const auto leaf = node.get_leaf_node();
+				for(int index = 0 ; index < leaf->_used ; index++){
+					STEADY_TRACE_SS("#" << std::to_string(index) << "\t" << leaf->get_values()[index]);
+				}
+			}
+			else{
+				STEADY_ASSERT(false);
+			}
+		}
+
+		/*
+			Validates the list, not that the children är valid.
+		*/
+		template <class T, class RC>
+		bool validate_inode_children(const std::array<node_ref<T, RC>, BRANCHING_FACTOR>& vec){
+			STEADY_ASSERT(vec.size() >= 0);
+			STEADY_ASSERT(vec.size() <= BRANCHING_FACTOR);
+
+			/*
+			for(auto i: vec){
+				i.check_invariant();
+			}
+			*/
+
+			if(vec.size() > 0){
+				const auto type = vec[0].get_type();
+				if(type == node_type::null_node){
+					for(const auto& i: vec){
+						STEADY_ASSERT(i.get_type() == node_type::null_node);
+					}
+				}
+				else if(type == node_type::inode){
+					size_t i = 0;
+					while(i < vec.size() && vec[i].get_type() == node_type::inode){
+						i++;
+					}
+					while(i < vec.size()){
+						STEADY_ASSERT(vec[i].get_type() == node_type::null_node);
+						i++;
+					}
+				}
+				else if(type == node_type::leaf_node){
+					size_t i = 0;
+					while(i < vec.size() && vec[i].get_type() == node_type::leaf_node){
+						i++;
+					}
+					while(i < vec.size()){
+						STEADY_ASSERT(vec[i].get_type() == node_type::null_node);
+						i++;
+					}
+				}
+				else{
+					STEADY_ASSERT(false);
+				}
+			}
+			return true;
+		}
+
+
+		template <class T, class RC = multi_thread>
+		node_ref<T, RC> make_leaf_node(const std::array<T, BRANCHING_FACTOR>& values){
+			return node_ref<T, RC>(leaf_node<T, RC>::make(values));
+		}
+
+		//	Makes a leaf node holding one value, constructed in place from _args_. capacity: see leaf_capacity().
+		template <class T, class RC, class... ARGS>
+		node_ref<T, RC> emplace_leaf_node(size_t capacity, ARGS&&... args){
+			auto result = node_ref<T, RC>(leaf_node<T, RC>::make(capacity));
+			result.get_leaf_node()->push(std::forward<ARGS>(args)...);
+			return result;
+		}
+
+		/*
+			Makes a leaf node holding copies of the first _count_ values of _values_, or the values moved out
+			of _values_ for MOVE.
+			capacity: room for this many values, see leaf_capacity(). 0: just big enough.
+		*/
+		template <class T, class RC = multi_thread, bool MOVE = false>
+		node_ref<T, RC> make_leaf_node(source_t<T, MOVE> values, size_t count, size_t capacity = 0){
+			STEADY_ASSERT(count <= BRANCHING_FACTOR);
+			STEADY_ASSERT(capacity == 0 || count <= capacity);
+
+			auto result = node_ref<T, RC>(leaf_node<T, RC>::make(capacity == 0 ? leaf_capacity(count) : capacity));
+			result.get_leaf_node()->template append<MOVE>(values, count);
+			return result;
+		}
+
+		template <class T, class RC>
+		node_ref<T, RC> make_inode_from_vector(const std::vector<node_ref<T, RC>>& children){
+			STEADY_ASSERT(children.size() <= BRANCHING_FACTOR);
+
+			std::array<node_ref<T, RC>, BRANCHING_FACTOR> temp{};
+			std::copy(children.begin(), children.end(), temp.begin());
+			return node_ref<T, RC>(inode<T, RC>::make(std::move(temp)));
+		}
+
+
+		template <class T, class RC>
+		node_ref<T, RC> make_inode_from_array(const std::array<node_ref<T, RC>, BRANCHING_FACTOR>& children){
+			return node_ref<T, RC>(inode<T, RC>::make(children));
+		}
+
+
+		/*
+			Verifies the tree is valid.
+			### improve
+		*/
+		template <class T, class RC>
+		bool tree_check_invariant(const node_ref<T, RC>& tree, size_t size){
+			STEADY_ASSERT(tree.check_invariant());
+		#if STEADY_ASSERT_ON
+			if(size == 0){
+				STEADY_ASSERT(tree.get_type() == node_type::null_node);
+			}
+			else{
+				STEADY_ASSERT(tree.get_type() != node_type::null_node);
+			}
+		#endif
+			return true;
+		}
+
+
+		/*
+			Walks the entire tree and verifies every inode: children of regular inodes are full except the last one,
+			size tables add up. This is slow - O(n) - use from unit tests.
+
+			count: number of values in _node_.
+		*/
+		template <class T, class RC>
+		bool validate_tree(const node_ref<T, RC>& node, int shift, size_t count){
+			if(count == 0){
+				STEADY_ASSERT(node.get_type() == node_type::null_node);
+			}
+			else if(shift == LEAF_NODE_SHIFT){
+				STEADY_ASSERT(node.get_type() == node_type::leaf_node);
+				STEADY_ASSERT(count <= BRANCHING_FACTOR);
+				STEADY_ASSERT(node.get_leaf_node()->_used >= static_cast<int32_t>(count));
+			}
+			else{
+				STEADY_ASSERT(node.get_type() == node_type::inode);
+
+				const auto& n = *node.get_inode();
+				const auto child_count = n.count_children();
+				const auto child_max = shift_to_max_size(shift - BRANCHING_FACTOR_SHIFT);
+				STEADY_ASSERT(child_count > 0);
+
+				size_t total = 0;
+				for(size_t i = 0 ; i < child_count ; i++){
+					const auto c = get_child_count(n, shift, count, i);
+					STEADY_ASSERT(c > 0);
+					if(n._sizes == nullptr && i + 1 < child_count){
+						STEADY_ASSERT(c == child_max);
+					}
+					validate_tree(n._children[i], shift - BRANCHING_FACTOR_SHIFT, c);
+					total += c;
+				}
+				STEADY_ASSERT(total == count);
+				(void)child_max;
+			}
+			return true;
+		}
+
+
+		/*
+			Returns the number of values in child number _index_ of _node_.
+
+			shift: shift of _node_.
+			count: number of values in _node_.
+		*/
+		template <class T, class RC>
+		size_t get_child_count(const inode<T, RC>& node, int shift, size_t count, size_t index){
+			STEADY_ASSERT(index < BRANCHING_FACTOR);
+
+			if(node._sizes != nullptr){
+				const auto& sizes = *node._sizes;
+				return index == 0 ? sizes[0] : sizes[index] - sizes[index - 1];
+			}
+			else{
+				const auto child_max = shift_to_max_size(shift - BRANCHING_FACTOR_SHIFT);
+				STEADY_ASSERT(count > index * child_max);
+				return std::min(child_max, count - index * child_max);
+			}
+		}
+
+
+		/*
+			Returns which child of _node_ that holds value _index_.
+
+			index: in: index inside _node_. out: index inside the child.
+		*/
+		template <class T, class RC>
+		size_t find_child(const inode<T, RC>& node, int shift, size_t& index){
+			size_t slot_index = index >> shift;
+
+			if(node._sizes == nullptr){
+				index -= slot_index << shift;
+			}
+			else{
+				//	The radix guess is never past the right slot, only before it.
+				const auto& sizes = *node._sizes;
+				while(sizes[slot_index] <= index){
+					slot_index++;
+				}
+				if(slot_index > 0){
+					index -= sizes[slot_index - 1];
+				}
+			}
+			STEADY_ASSERT(slot_index < BRANCHING_FACTOR);
+			return slot_index;
+		}
+
+
+		/*
+			Finds the leaf node holding value _index_. Doesn't touch any reference counters.
+
+			index: in: index in the tree. out: index inside the leaf node.
+			count: in: number of values in the tree. out: number of values in the leaf node.
+		*/
+		template <class T, class RC>
+		const node_ref<T, RC>& find_leaf_node(const node_ref<T, RC>& root, int shift, size_t& index, size_t& count){
+			STEADY_ASSERT(index < count);
+
+			const node_ref<T, RC>* node_it = &root;
+			while(shift > LEAF_NODE_SHIFT){
+				const auto& node = *node_it->get_inode();
+				const auto slot_index = find_child(node, shift, index);
+				count = get_child_count(node, shift, count, slot_index);
+				node_it = &node._children[slot_index];
+				shift -= BRANCHING_FACTOR_SHIFT;
+			}
+
+			STEADY_ASSERT(node_it->get_type() == node_type::leaf_node);
+			return *node_it;
+		}
+
+
+		/*
+			A node and the number of values in it. Nodes don't know their own size - their parent does.
+		*/
+		template <class T, class RC = multi_thread>
+		struct counted_node {
+			node_ref<T, RC> _node;
+			size_t _count;
+		};
+
+
+		/*
+			Copies the children of inode _node_, and how many values each of them holds, to _out_.
+			Returns the number of children.
+		*/
+		template <class T, class RC>
+		size_t get_counted_children(const node_ref<T, RC>& node, int shift, size_t count, counted_node<T, RC> out[]){
+			const auto& n = *node.get_inode();
+			const auto child_count = n.count_children();
+			for(size_t i = 0 ; i < child_count ; i++){
+				out[i]._node = n._children[i];
+				out[i]._count = get_child_count(n, shift, count, i);
+			}
+			return child_count;
+		}
+
+
+		/*
+			Calculates the cumulative size table for an inode at _shift_ holding _children_.
+			Returns true if the inode can be regular, that is all children but the last are full.
+		*/
+		template <class T, class RC>
+		bool calc_sizes(const counted_node<T, RC> children[], size_t child_count, int shift, typename inode<T, RC>::sizes_t& out_sizes){
+			const auto child_max = shift_to_max_size(shift - BRANCHING_FACTOR_SHIFT);
+
+			bool regular = true;
+			size_t total = 0;
+			for(size_t i = 0 ; i < child_count ; i++){
+				total += children[i]._count;
+				out_sizes[i] = total;
+				if(i + 1 < child_count && children[i]._count != child_max){
+					regular = false;
+				}
+			}
+			return regular;
+		}
+
+
+		/*
+			Makes an inode at _shift_ holding _children_. It is regular if possible, else relaxed.
+			edit: the new inode is tagged with this edit token.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> make_inode(const counted_node<T, RC> children[], size_t child_count, int shift, edit_t edit){
+			STEADY_ASSERT(child_count > 0 && child_count <= BRANCHING_FACTOR);
+
+			typename inode<T, RC>::sizes_t sizes{};
+			const bool regular = calc_sizes(children, child_count, shift, sizes);
+
+			std::array<node_ref<T, RC>, BRANCHING_FACTOR> temp{};
+			for(size_t i = 0 ; i < child_count ; i++){
+				temp[i] = children[i]._node;
+			}
+
+			auto result = regular ? node_ref<T, RC>(inode<T, RC>::make(std::move(temp))) : node_ref<T, RC>(inode<T, RC>::make(std::move(temp), sizes));
+			result.get_inode()->_edit = edit;
+			return result;
+		}
+
+
+		/*
+			Like make_inode() but mutates and returns _node_ if it is editable by _edit_.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> update_inode(const node_ref<T, RC>& node, const counted_node<T, RC> children[], size_t child_count, int shift, edit_t edit){
+			STEADY_ASSERT(node.get_type() == node_type::inode);
+
+			if(edit != NO_EDIT && node.get_inode()->_edit == edit){
+				typename inode<T, RC>::sizes_t sizes{};
+				const bool regular = calc_sizes(children, child_count, shift, sizes);
+
+				auto n = node.get_inode();
+				if(regular == (n->_sizes == nullptr)){
+					//	Only touch the children that change, unchanged ones keep their reference counts.
+					for(size_t i = 0 ; i < BRANCHING_FACTOR ; i++){
+						if(i < child_count){
+							if(n->_children[i]._ptr != children[i]._node._ptr){
+								n->_children[i] = children[i]._node;
+							}
+						}
+						else if(n->_children[i]._ptr != 0){
+							n->_children[i] = node_ref<T, RC>();
+						}
+					}
+					if(!regular){
+						*n->_sizes = sizes;
+					}
+					return node;
+				}
+			}
+			return make_inode(children, child_count, shift, edit);
+		}
+
+
+		/*
+			Returns _node_ if it is editable by _edit_, else a copy of it that is. NO_EDIT always copies.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> make_editable_inode(const node_ref<T, RC>& node, edit_t edit){
+			STEADY_ASSERT(node.get_type() == node_type::inode);
+
+			if(edit != NO_EDIT && node.get_inode()->_edit == edit){
+				return node;
+			}
+			else{
+				const auto& n = *node.get_inode();
+				auto copy = n._sizes == nullptr
+					? node_ref<T, RC>(inode<T, RC>::make(n._children))
+					: node_ref<T, RC>(inode<T, RC>::make(n._children, *n._sizes));
+				copy.get_inode()->_edit = edit;
+				return copy;
+			}
+		}
+
+
+		/*
+			Tags the nodes on the path from _root_ to value _index_ with _edit_, for as long as this vector holds the
+			only reference to them. Functions taking _edit_ then mutate those nodes in place instead of copying them.
+			Stops at the first shared node: all nodes below it are shared too, whatever their reference count says.
+		*/
+		template <class T, class RC>
+		void tag_unique_path(const node_ref<T, RC>& root, int shift, size_t index, edit_t edit){
+			STEADY_ASSERT(edit != NO_EDIT);
+
+			const node_ref<T, RC>* node_it = &root;
+			while(shift > LEAF_NODE_SHIFT){
+				auto& node = *node_it->get_inode();
+				if(!RC::is_unique(&node)){
+					return;
+				}
+				node._edit = edit;
+				node_it = &node._children[find_child(node, shift, index)];
+				shift -= BRANCHING_FACTOR_SHIFT;
+			}
+
+			const auto leaf = node_it->get_leaf_node();
+			if(RC::is_unique(leaf)){
+				leaf->_edit = edit;
+			}
+		}
+
+
+		/*
+			Returns _node_ if it is editable by _edit_ and has room for _capacity_ values, else a copy of its first
+			_count_ values that is. NO_EDIT always copies. An editable node that is too small is only used by the
+			caller, which replaces it with the result: its values are moved to the copy, not copied.
+
+			capacity: 0 = _count_.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> make_editable_leaf_node(const node_ref<T, RC>& node, size_t count, edit_t edit, size_t capacity = 0){
+			STEADY_ASSERT(node.get_type() == node_type::leaf_node);
+
+			const auto leaf = node.get_leaf_node();
+			const auto editable = edit != NO_EDIT && leaf->_edit == edit;
+			if(editable && static_cast<size_t>(leaf->_capacity) >= std::max(count, capacity)){
+				return node;
+			}
+			else{
+				const auto copy_capacity = capacity == 0 ? 0 : leaf_capacity(capacity);
+				auto copy = editable
+					? make_leaf_node<T, RC, true>(leaf->get_values(), count, copy_capacity)
+					: make_leaf_node<T, RC>(leaf->get_values(), count, copy_capacity);
+				copy.get_leaf_node()->_edit = edit;
+				return copy;
+			}
+		}
+
+
+		/*
+			Recursively finds the correct leaf node and replaces the value _value_ with it. Returns new tree.
+
+			node: original tree. Not changed by function, unless its nodes are editable by _edit_. Cannot be null node.
+			shift: shift for current level in tree.
+			count: number of values in _node_.
+			index: entry to store "value" to.
+			value: value to store.
+			edit: NO_EDIT for persistent vectors.
+			result: copy of "tree" that has "value" stored. Same size as original.
+				result-tree and original tree shares internal state.
+		*/
+		template <class T, class RC, class U>
+		node_ref<T, RC> replace_value(const node_ref<T, RC>& node, int shift, size_t count, size_t index, U&& value, edit_t edit){
+			STEADY_ASSERT(node.get_type() == node_type::inode || node.get_type() == node_type::leaf_node);
+			STEADY_ASSERT(index < count);
+
+			if(shift == LEAF_NODE_SHIFT){
+				auto copy = make_editable_leaf_node(node, count, edit);
+				copy.get_leaf_node()->get_values()[index] = std::forward<U>(value);
+				return copy;
+			}
+			else{
+				const auto& n = *node.get_inode();
+				size_t child_index = index;
+				const auto slot_index = find_child(n, shift, child_index);
+				const auto child_count = get_child_count(n, shift, count, slot_index);
+				auto child2 = replace_value(n._children[slot_index], shift - BRANCHING_FACTOR_SHIFT, child_count, child_index, std::forward<U>(value), edit);
+
+				auto copy = make_editable_inode(node, edit);
+				copy.get_inode()->_children[slot_index] = std::move(child2);
+				return copy;
+			}
+		}
+
+
+		/*
+			Returns a copy of the tail leaf node with _value_ stored at _index_.
+
+			tail_count: how many values of the tail the vector uses. Only those are copied.
+		*/
+		template <class T, class RC, class U>
+		node_ref<T, RC> replace_tail_value(const node_ref<T, RC>& tail, size_t tail_count, size_t index, U&& value){
+			STEADY_ASSERT(tail.get_type() == node_type::leaf_node);
+			STEADY_ASSERT(index < tail_count);
+
+			auto copy = make_leaf_node<T, RC>(tail.get_leaf_node()->get_values(), tail_count);
+			copy.get_leaf_node()->get_values()[index] = std::forward<U>(value);
+			return copy;
+		}
+
+
+		/*
+			Creates a leaf node with zero to many parent inodes (all inodes only contain one item).
+
+			Example path:
+				inode
+					inode
+						inode
+							leaf_node
+
+			Example path:
+				inode
+					leaf_node
+
+			Example path:
+				leaf_node
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> make_new_path(int shift, const counted_node<T, RC>& leaf_node, edit_t edit){
+			STEADY_ASSERT(leaf_node._node.get_type() == node_type::leaf_node);
+
+			if(shift == LEAF_NODE_SHIFT){
+				return leaf_node._node;
+			}
+			else{
+				const counted_node<T, RC> a { make_new_path(shift - BRANCHING_FACTOR_SHIFT, leaf_node, edit), leaf_node._count };
+				return make_inode(&a, 1, shift, edit);
+			}
+		}
+
+
+		/*
+			Appends _new_leaf_ last in inode _node_. Returns the new inode or a null node if there is no room in it.
+			count: number of values in _node_.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> push_back_leaf_node_sub(const node_ref<T, RC>& node, int shift, size_t count, const counted_node<T, RC>& new_leaf, edit_t edit){
+			counted_node<T, RC> children[BRANCHING_FACTOR];
+			const auto child_count = get_counted_children(node, shift, count, children);
+
+			if(shift > LOWEST_LEVEL_INODE_SHIFT){
+				auto& last = children[child_count - 1];
+				auto last2 = push_back_leaf_node_sub(last._node, shift - BRANCHING_FACTOR_SHIFT, last._count, new_leaf, edit);
+				if(last2.get_type() != node_type::null_node){
+					last._node = std::move(last2);
+					last._count += new_leaf._count;
+					return update_inode(node, children, child_count, shift, edit);
+				}
+			}
+
+			if(child_count == BRANCHING_FACTOR){
+				return node_ref<T, RC>();
+			}
+			else{
+				children[child_count] = counted_node<T, RC>{ make_new_path(shift - BRANCHING_FACTOR_SHIFT, new_leaf, edit), new_leaf._count };
+				return update_inode(node, children, child_count + 1, shift, edit);
+			}
+		}
+
+
+		/*
+			Appends a leaf node last in the tree. Returns new tree.
+
+			root: original tree. Not changed by function, unless its nodes are editable by _edit_. Can be null node.
+			shift: shift of the original tree. On return it holds the shift of the new tree, which may be one level deeper.
+			tree_size: number of values in the original tree.
+			new_leaf: the leaf node to append and how many of its values are used. Will be shared, not copied.
+				Only a full leaf node keeps the tree regular.
+			edit: NO_EDIT for persistent vectors.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> push_back_leaf_node(const node_ref<T, RC>& root, int& shift, size_t tree_size, const counted_node<T, RC>& new_leaf, edit_t edit){
+			STEADY_ASSERT(tree_check_invariant(root, tree_size));
+			STEADY_ASSERT(new_leaf._node.check_invariant());
+			STEADY_ASSERT(new_leaf._node.get_type() == node_type::leaf_node);
+			STEADY_ASSERT(new_leaf._count > 0 && new_leaf._count <= BRANCHING_FACTOR);
+
+			if(tree_size == 0){
+				shift = LEAF_NODE_SHIFT;
+				return new_leaf._node;
+			}
+
+			if(shift > LEAF_NODE_SHIFT){
+				auto result = push_back_leaf_node_sub(root, shift, tree_size, new_leaf, edit);
+				if(result.get_type() != node_type::null_node){
+					return result;
+				}
+			}
+
+			//	No room: grow the tree one level.
+			const counted_node<T, RC> children[] = {
+				counted_node<T, RC>{ root, tree_size },
+				counted_node<T, RC>{ make_new_path(shift, new_leaf, edit), new_leaf._count }
+			};
+			shift += BRANCHING_FACTOR_SHIFT;
+			return make_inode(children, 2, shift, edit);
+		}
+
+
+		/*
+			Removes inodes at the top of the tree that only have one child.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> collapse_root(const node_ref<T, RC>& root, int& shift){
+			node_ref<T, RC> result = root;
+			while(shift > LEAF_NODE_SHIFT && result.get_inode()->count_children() == 1){
+				result = node_ref<T, RC>(result.get_inode()->_children[0]);
+				shift -= BRANCHING_FACTOR_SHIFT;
+			}
+			return result;
+		}
+
+
+		/*
+			Removes the last leaf node from inode _node_. Returns the new node, or a null node if _node_ became empty.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> pop_back_leaf_node_sub(const node_ref<T, RC>& node, int shift, size_t count, edit_t edit, counted_node<T, RC>& out_leaf){
+			counted_node<T, RC> children[BRANCHING_FACTOR];
+			auto child_count = get_counted_children(node, shift, count, children);
+			auto& last = children[child_count - 1];
+
+			if(shift == LOWEST_LEVEL_INODE_SHIFT){
+				out_leaf = std::move(last);
+				child_count--;
+			}
+			else{
+				auto last2 = pop_back_leaf_node_sub(last._node, shift - BRANCHING_FACTOR_SHIFT, last._count, edit, out_leaf);
+				if(last2.get_type() == node_type::null_node){
+					child_count--;
+				}
+				else{
+					last._node = std::move(last2);
+					last._count -= out_leaf._count;
+				}
+			}
+			return child_count == 0 ? node_ref<T, RC>() : update_inode(node, children, child_count, shift, edit);
+		}
+
+
+		/*
+			Removes the last leaf node from the tree and returns it, with its value count, in _out_leaf_. Collapses
+			the root when it has only one child left.
+
+			root: original tree. Not changed by function, unless its nodes are editable by _edit_.
+			shift: in-out.
+			tree_size: number of values in tree.
+			edit: NO_EDIT for persistent vectors.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> pop_back_leaf_node(const node_ref<T, RC>& root, int& shift, size_t tree_size, edit_t edit, counted_node<T, RC>& out_leaf){
+			STEADY_ASSERT(tree_check_invariant(root, tree_size));
+			STEADY_ASSERT(tree_size > 0);
+
+			if(shift == LEAF_NODE_SHIFT){
+				out_leaf = counted_node<T, RC>{ root, tree_size };
+				shift = EMPTY_TREE_SHIFT;
+				return node_ref<T, RC>();
+			}
+			else{
+				const auto result = pop_back_leaf_node_sub(root, shift, tree_size, edit, out_leaf);
+				if(result.get_type() == node_type::null_node){
+					shift = EMPTY_TREE_SHIFT;
+					return result;
+				}
+				return collapse_root(result, shift);
+			}
+		}
+
+
+		/*
+			Returns a tree holding the first _n_ values of tree _node_. Only the rightmost path is copied, the last
+			leaf node is shared even if it becomes partial: its count is implied by its parent.
+
+			count: number of values in _node_.
+			n: 0 < n <= count.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> take_tree(const node_ref<T, RC>& node, int shift, size_t count, size_t n, edit_t edit){
+			STEADY_ASSERT(n > 0 && n <= count);
+
+			if(n == count || shift == LEAF_NODE_SHIFT){
+				return node;
+			}
+			else{
+				counted_node<T, RC> children[BRANCHING_FACTOR];
+				get_counted_children(node, shift, count, children);
+
+				size_t last_index = n - 1;
+				const auto slot_index = find_child(*node.get_inode(), shift, last_index);
+				auto& last = children[slot_index];
+				last._node = take_tree(last._node, shift - BRANCHING_FACTOR_SHIFT, last._count, last_index + 1, edit);
+				last._count = last_index + 1;
+				return update_inode(node, children, slot_index + 1, shift, edit);
+			}
+		}
+
+
+		/*
+			Returns a tree without the first _n_ values of tree _node_. Only the leftmost path is copied.
+			The first leaf node is copied when _n_ doesn't fall on a leaf node boundary.
+
+			count: number of values in _node_.
+			n: 0 <= n < count.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> drop_tree(const node_ref<T, RC>& node, int shift, size_t count, size_t n, edit_t edit){
+			STEADY_ASSERT(n < count);
+
+			if(n == 0){
+				return node;
+			}
+			else if(shift == LEAF_NODE_SHIFT){
+				auto result = make_leaf_node<T, RC>(&node.get_leaf_node()->get_values()[n], count - n);
+				result.get_leaf_node()->_edit = edit;
+				return result;
+			}
+			else{
+				counted_node<T, RC> children[BRANCHING_FACTOR];
+				const auto child_count = get_counted_children(node, shift, count, children);
+
+				size_t first_index = n;
+				const auto slot_index = find_child(*node.get_inode(), shift, first_index);
+				auto& first = children[slot_index];
+				first._node = drop_tree(first._node, shift - BRANCHING_FACTOR_SHIFT, first._count, first_index, edit);
+				first._count -= first_index;
+				return make_inode(&children[slot_index], child_count - slot_index, shift, edit);
+			}
+		}
+
+
+		/*
+			Returns how many values there are before the leaf node holding value _index_. This is where drop_tree() can
+			cut without copying any leaf node.
+		*/
+		template <class T, class RC>
+		size_t get_leaf_start(const node_ref<T, RC>& root, int shift, size_t count, size_t index){
+			size_t leaf_index = index;
+			size_t leaf_count = count;
+			find_leaf_node(root, shift, leaf_index, leaf_count);
+			return index - leaf_index;
+		}
+
+
+		/*
+			Appends a value, constructed from _args_, to the tail of the vector. If the tail is full it is first moved
+			into the tree and a new tail is started.
+
+			If nobody else has used the slot after our tail yet, we claim it and store the value directly in
+			the existing tail leaf node. This makes push_back() O(1) with about one memory allocation per
+			BRANCHING_FACTOR values.
+		*/
+		template <class T, class RC, class... ARGS>
+		vector<T, RC> push_back_1(const vector<T, RC>& original, ARGS&&... args) {
+			STEADY_ASSERT(original.check_invariant());
+
+			const auto size = original.size();
+			const auto offset = original.get_offset();
+			const auto tree_size = original.get_tree_size();
+			const auto tail_count = size + offset - tree_size;
+
+			if(size > 0 && tail_count < BRANCHING_FACTOR){
+				auto tail = original.get_tail();
+				auto tail_leaf = tail.get_leaf_node();
+
+				if(tail_leaf->claim(tail_count, 1)){
+					try {
+						new (tail_leaf->get_values() + tail_count) T(std::forward<ARGS>(args)...);
+					}
+					catch(...){
+						tail_leaf->unclaim(tail_count, 1);
+						throw;
+					}
+					return vector<T, RC>(original.get_root(), original.get_shift(), tree_size, std::move(tail), size + 1, offset);
+				}
+				else{
+					auto new_tail = make_leaf_node<T, RC>(tail_leaf->get_values(), tail_count, tail_capacity(tree_size, tail_count + 1));
+					new_tail.get_leaf_node()->push(std::forward<ARGS>(args)...);
+					return vector<T, RC>(original.get_root(), original.get_shift(), tree_size, std::move(new_tail), size + 1, offset);
+				}
+			}
+			else {
+				auto shift = original.get_shift();
+				auto root = size == 0
+					? original.get_root()
+					: push_back_leaf_node(original.get_root(), shift, tree_size, counted_node<T, RC>{ original.get_tail(), tail_count }, NO_EDIT);
+				auto new_tail = emplace_leaf_node<T, RC>(size == 0 ? 1 : BRANCHING_FACTOR, std::forward<ARGS>(args)...);
+				return vector<T, RC>(std::move(root), shift, size == 0 ? 0 : tree_size + tail_count, std::move(new_tail), size + 1, offset);
+			}
+		}
+
+
+		/*
+			This is the central building block: adds many values to a vector (or a create a new vector) fast.
+			edit: the tree nodes of _original_ tagged with _edit_ are mutated in place. NO_EDIT: copies the path.
+				A tail tagged with _edit_ that is too small has its values moved to the bigger copy.
+			MOVE: moves the values out of _values_ instead of copying them.
+		*/
+#if 0
+		template <class T, class RC>
+		vector<T, RC> push_back_batch(const vector<T, RC>& original, const T values[], size_t count){
+			STEADY_ASSERT(original.check_invariant());
+			STEADY_ASSERT(values != nullptr);
+
+			vector<T, RC> result = original;
+			for(size_t i = 0 ; i < count ; i++){
+				result = result.push_back(values[i]);
+			}
+			return result;
+		}
+
+#else
+
+		template <class T, class RC, bool MOVE = false>
+		vector<T, RC> push_back_batch(const vector<T, RC>& original, source_t<T, MOVE> values, std::size_t count, edit_t edit = NO_EDIT){
+			STEADY_ASSERT(original.check_invariant());
+			STEADY_ASSERT(values != nullptr);
+
+			auto root = original.get_root();
+			auto shift = original.get_shift();
+			auto tree_size = original.get_tree_size();
+			auto tail = original.get_tail();
+			auto size = original.size();
+			const auto offset = original.get_offset();
+			size_t source_pos = 0;
+
+			/*
+				1) If the tail is partially filled, pad it out. Fill it in place if we can claim its free values.
+			*/
+			{
+				const size_t tail_count = size + offset - tree_size;
+				if(size > 0 && tail_count < BRANCHING_FACTOR && count > 0){
+					const size_t copy_count = std::min(BRANCHING_FACTOR - tail_count, count);
+					auto tail_leaf = tail.get_leaf_node();
+
+					if(tail_leaf->claim(tail_count, copy_count)){
+						try {
+							value_ops<T>::construct(tail_leaf->get_values() + tail_count, values, copy_count, std::integral_constant<bool, MOVE>());
+						}
+						catch(...){
+							tail_leaf->unclaim(tail_count, copy_count);
+							throw;
+						}
+					}
+					else{
+						const auto capacity = tail_capacity(tree_size, tail_count + copy_count);
+						node_ref<T, RC> new_tail = edit != NO_EDIT && tail_leaf->_edit == edit
+							? make_leaf_node<T, RC, true>(tail_leaf->get_values(), tail_count, capacity)
+							: make_leaf_node<T, RC>(tail_leaf->get_values(), tail_count, capacity);
+						new_tail.get_leaf_node()->template append<MOVE>(values, copy_count);
+						tail = std::move(new_tail);
+					}
+					size += copy_count;
+					source_pos += copy_count;
+				}
+			}
+
+			/*
+				2) Move the full tail into the tree and make a new tail. One entire leaf node at a time.
+			*/
+			while(source_pos < count){
+				if(size > 0){
+					STEADY_ASSERT(size + offset - tree_size == BRANCHING_FACTOR);
+					root = push_back_leaf_node(root, shift, tree_size, counted_node<T, RC>{ tail, BRANCHING_FACTOR }, edit);
+					tree_size = size + offset;
+				}
+
+				const size_t batch_count = std::min(count - source_pos, static_cast<std::size_t>(BRANCHING_FACTOR));
+				tail = make_leaf_node<T, RC, MOVE>(&values[source_pos], batch_count, tail_capacity(tree_size, batch_count));
+				size += batch_count;
+				source_pos += batch_count;
+			}
+
+			auto result = vector<T, RC>(std::move(root), shift, tree_size, std::move(tail), size, offset);
+			STEADY_ASSERT(result.size() == original.size() + count);
+			return result;
+		}
+#endif
+
+
+		/*
+			Makes a new vector from _count_ values bottom up: first all the leaf nodes, then each level of inodes
+			from the one below it, once. Gives the same tree as push_back_batch() on an empty vector - full leaf
+			nodes and the last 1 - BRANCHING_FACTOR values in the tail - but without the path copies and
+			throwaway inodes of pushing one leaf node at a time.
+
+			make_leaf: make_leaf(pos, count, capacity) returns a leaf node with room for _capacity_ values,
+				holding the _count_ values starting at value _pos_. Called in order of _pos_.
+		*/
+		template <class T, class RC, class MAKE_LEAF>
+		vector<T, RC> build_vector(std::size_t count, const MAKE_LEAF& make_leaf){
+			if(count == 0){
+				return vector<T, RC>();
+			}
+
+			const size_t tail_count = (count - 1) % BRANCHING_FACTOR + 1;
+			const size_t tree_size = count - tail_count;
+
+			node_ref<T, RC> root;
+			int shift = EMPTY_TREE_SHIFT;
+			if(tree_size > 0){
+				//	Holds one level of the tree at a time. Each inode level is written over the start of the level below.
+				std::vector<node_ref<T, RC>> level;
+				level.reserve(tree_size / BRANCHING_FACTOR);
+				for(size_t pos = 0 ; pos < tree_size ; pos += BRANCHING_FACTOR){
+					level.push_back(make_leaf(pos, BRANCHING_FACTOR, BRANCHING_FACTOR));
+				}
+				shift = LEAF_NODE_SHIFT;
+
+				while(level.size() > 1){
+					const size_t node_count = (level.size() - 1) / BRANCHING_FACTOR + 1;
+					for(size_t i = 0 ; i < node_count ; i++){
+						const size_t begin = i * BRANCHING_FACTOR;
+						const size_t end = std::min(begin + BRANCHING_FACTOR, level.size());
+
+						//	All children are full but the last one: a regular inode, no sizes.
+						typename inode<T, RC>::children_t children{};
+						std::move(level.begin() + begin, level.begin() + end, children.begin());
+						level[i] = node_ref<T, RC>(inode<T, RC>::make(std::move(children)));
+					}
+					level.resize(node_count);
+					shift += BRANCHING_FACTOR_SHIFT;
+				}
+				root = std::move(level[0]);
+			}
+
+			auto tail = make_leaf(tree_size, tail_count, tail_capacity(tree_size, tail_count));
+			auto result = vector<T, RC>(std::move(root), shift, tree_size, std::move(tail), count, 0);
+			STEADY_ASSERT(result.check_invariant());
+			return result;
+		}
+
+		//	Calls f(values, count) for each block of _source_ holding the _count_ values from _pos_ on, in order.
+		template <class VECTOR, class F>
+		void for_each_block(const VECTOR& source, size_t pos, size_t count, const F& f){
+			size_t index = pos;
+			while(index < pos + count){
+				size_t block_count = 0;
+				const auto values = source.get_block(index, block_count);
+				block_count = std::min(block_count, pos + count - index);
+				f(values, block_count);
+				index += block_count;
+			}
+		}
+
+		//	build_vector() from an array. MOVE: moves the values out of _values_ instead of copying them.
+		template <class T, class RC, bool MOVE = false>
+		vector<T, RC> build_vector(source_t<T, MOVE> values, std::size_t count){
+			STEADY_ASSERT(values != nullptr);
+
+			return build_vector<T, RC>(count, [values](size_t pos, size_t leaf_count, size_t capacity){
+				return make_leaf_node<T, RC, MOVE>(&values[pos], leaf_count, capacity);
+			});
+		}
+
+
+
+
+		////////////////////////////////////////////		Concatenation (RRB-tree)
+
+		/*
+			Concatenation only rebalances the nodes along the seam between the two trees. It allows a level to
+			use up to RRB_EXTRA_NODES more nodes than the optimum, which keeps the copying down and keeps lookups
+			in relaxed inodes to a few steps of linear search.
+
+			Read "RRB-Trees: Efficient Immutable Vectors", Bagwell & Rompf and "Improving RRB-Tree Performance
+			through Transience", l'orange.
+		*/
+
+		static const size_t RRB_EXTRA_NODES = 2;
+
+
+		/*
+			The number of slots of _node_ that concatenation balances: values for a leaf node, children for an inode.
+		*/
+		template <class T, class RC>
+		size_t get_slot_count(const counted_node<T, RC>& node, int shift){
+			return shift == LEAF_NODE_SHIFT ? node._count : node._node.get_inode()->count_children();
+		}
+
+		template <class T, class RC>
+		counted_node<T, RC> get_first_child(const counted_node<T, RC>& node, int shift){
+			const auto& n = *node._node.get_inode();
+			return counted_node<T, RC>{ n._children[0], get_child_count(n, shift, node._count, 0) };
+		}
+
+		template <class T, class RC>
+		counted_node<T, RC> get_last_child(const counted_node<T, RC>& node, int shift){
+			const auto& n = *node._node.get_inode();
+			const auto index = n.count_children() - 1;
+			return counted_node<T, RC>{ n._children[index], get_child_count(n, shift, node._count, index) };
+		}
+
+
+		/*
+			Redistributes the slots of _nodes_ over fewer nodes, until there are at most RRB_EXTRA_NODES more nodes
+			than needed. Nodes that don't need to change are reused as they are.
+
+			nodes: all nodes have shift _shift_.
+		*/
+		template <class T, class RC>
+		std::vector<counted_node<T, RC>> rebalance_nodes(const std::vector<counted_node<T, RC>>& nodes, int shift){
+			std::vector<size_t> plan;
+			size_t total = 0;
+			for(const auto& i: nodes){
+				plan.push_back(get_slot_count(i, shift));
+				total += plan.back();
+			}
+
+			const size_t optimal = divide_round_up(total, BRANCHING_FACTOR);
+			if(plan.size() <= optimal + RRB_EXTRA_NODES){
+				return nodes;
+			}
+
+			/*
+				Make the plan: find the first node that isn't almost full and shuffle its slots into the nodes to
+				its right, until that node can be removed. Repeat until there are few enough nodes.
+			*/
+			size_t i = 0;
+			while(plan.size() > optimal + RRB_EXTRA_NODES){
+				while(plan[i] > BRANCHING_FACTOR - RRB_EXTRA_NODES / 2){
+					i++;
+				}
+
+				size_t remaining = plan[i];
+				while(remaining > 0){
+					STEADY_ASSERT(i + 1 < plan.size());
+
+					const auto min_size = std::min(remaining + plan[i + 1], static_cast<size_t>(BRANCHING_FACTOR));
+					plan[i] = min_size;
+					remaining = remaining + plan[i + 1] - min_size;
+					i++;
+				}
+				plan.erase(plan.begin() + i);
+				i--;
+			}
+
+			/*
+				Execute the plan.
+			*/
+			std::vector<counted_node<T, RC>> result;
+			size_t source_index = 0;
+
+			//	Position inside nodes[source_index].
+			size_t source_pos = 0;
+
+			for(const auto size: plan){
+				if(source_pos == 0 && get_slot_count(nodes[source_index], shift) == size){
+					result.push_back(nodes[source_index]);
+					source_index++;
+				}
+				else if(shift == LEAF_NODE_SHIFT){
+					auto leaf = node_ref<T, RC>(leaf_node<T, RC>::make(leaf_capacity(size)));
+					size_t pos = 0;
+					while(pos < size){
+						const auto& source = nodes[source_index];
+						const auto copy_count = std::min(size - pos, source._count - source_pos);
+						leaf.get_leaf_node()->append(&source._node.get_leaf_node()->get_values()[source_pos], copy_count);
+						pos += copy_count;
+						source_pos += copy_count;
+						if(source_pos == source._count){
+							source_index++;
+							source_pos = 0;
+						}
+					}
+					STEADY_ASSERT(leaf.get_leaf_node()->_used == static_cast<int32_t>(size));
+					result.push_back(counted_node<T, RC>{ leaf, size });
+				}
+				else{
+					counted_node<T, RC> children[BRANCHING_FACTOR];
+					size_t pos = 0;
+					size_t count = 0;
+					while(pos < size){
+						counted_node<T, RC> source_children[BRANCHING_FACTOR];
+						const auto& source = nodes[source_index];
+						const auto source_child_count = get_counted_children(source._node, shift, source._count, source_children);
+						const auto copy_count = std::min(size - pos, source_child_count - source_pos);
+						for(size_t c = 0 ; c < copy_count ; c++){
+							children[pos + c] = source_children[source_pos + c];
+							count += source_children[source_pos + c]._count;
+						}
+						pos += copy_count;
+						source_pos += copy_count;
+						if(source_pos == source_child_count){
+							source_index++;
+							source_pos = 0;
+						}
+					}
+					result.push_back(counted_node<T, RC>{ make_inode(children, size, shift, NO_EDIT), count });
+				}
+			}
+			STEADY_ASSERT(source_index == nodes.size());
+			return result;
+		}
+
+
+		/*
+			Merges the children of inodes _left_ and _right_ with the children of _mid_, which replaces the last child
+			of _left_ and the first child of _right_. The children are rebalanced.
+
+			left, right: inodes with shift _shift_, or nullptr.
+			mid: inode with shift _shift_.
+			result: inode with shift _shift_ + BRANCHING_FACTOR_SHIFT, holding 1 or 2 children.
+		*/
+		template <class T, class RC>
+		counted_node<T, RC> rebalance(const counted_node<T, RC>* left, const counted_node<T, RC>& mid, const counted_node<T, RC>* right, int shift){
+			std::vector<counted_node<T, RC>> all;
+			counted_node<T, RC> children[BRANCHING_FACTOR];
+			if(left != nullptr){
+				const auto n = get_counted_children(left->_node, shift, left->_count, children);
+				all.insert(all.end(), &children[0], &children[n - 1]);
+			}
+			{
+				const auto n = get_counted_children(mid._node, shift, mid._count, children);
+				all.insert(all.end(), &children[0], &children[n]);
+			}
+			if(right != nullptr){
+				const auto n = get_counted_children(right->_node, shift, right->_count, children);
+				all.insert(all.end(), &children[1], &children[n]);
+			}
+
+			const auto balanced = rebalance_nodes(all, shift - BRANCHING_FACTOR_SHIFT);
+			STEADY_ASSERT(balanced.size() <= BRANCHING_FACTOR * 2);
+
+			size_t total = 0;
+			for(const auto& i: balanced){
+				total += i._count;
+			}
+
+			counted_node<T, RC> nodes[2];
+			size_t node_count = 0;
+			for(size_t pos = 0 ; pos < balanced.size() ; pos += BRANCHING_FACTOR){
+				const auto n = std::min(balanced.size() - pos, static_cast<size_t>(BRANCHING_FACTOR));
+				size_t count = 0;
+				for(size_t c = 0 ; c < n ; c++){
+					count += balanced[pos + c]._count;
+				}
+				nodes[node_count] = counted_node<T, RC>{ make_inode(&balanced[pos], n, shift, NO_EDIT), count };
+				node_count++;
+			}
+			return counted_node<T, RC>{ make_inode(nodes, node_count, shift + BRANCHING_FACTOR_SHIFT, NO_EDIT), total };
+		}
+
+
+		/*
+			Concatenates subtree _left_ with subtree _right_. Walks down the right edge of _left_ and the left edge of
+			_right_ and rebalances the nodes along that seam on the way up.
+
+			result: inode with shift max(_left_shift_, _right_shift_) + BRANCHING_FACTOR_SHIFT, holding 1 or 2 children.
+		*/
+		template <class T, class RC>
+		counted_node<T, RC> concat_sub(const counted_node<T, RC>& left, int left_shift, const counted_node<T, RC>& right, int right_shift){
+			if(left_shift > right_shift){
+				const auto mid = concat_sub(get_last_child(left, left_shift), left_shift - BRANCHING_FACTOR_SHIFT, right, right_shift);
+				return rebalance(&left, mid, static_cast<const counted_node<T, RC>*>(nullptr), left_shift);
+			}
+			else if(left_shift < right_shift){
+				const auto mid = concat_sub(left, left_shift, get_first_child(right, right_shift), right_shift - BRANCHING_FACTOR_SHIFT);
+				return rebalance(static_cast<const counted_node<T, RC>*>(nullptr), mid, &right, right_shift);
+			}
+			else if(left_shift == LEAF_NODE_SHIFT){
+				const counted_node<T, RC> children[] = { left, right };
+				const auto merged = rebalance_nodes(std::vector<counted_node<T, RC>>(&children[0], &children[2]), LEAF_NODE_SHIFT);
+				return counted_node<T, RC>{ make_inode(&merged[0], merged.size(), LOWEST_LEVEL_INODE_SHIFT, NO_EDIT), left._count + right._count };
+			}
+			else{
+				const auto mid = concat_sub(
+					get_last_child(left, left_shift),
+					left_shift - BRANCHING_FACTOR_SHIFT,
+					get_first_child(right, right_shift),
+					right_shift - BRANCHING_FACTOR_SHIFT
+				);
+				return rebalance(&left, mid, &right, left_shift);
+			}
+		}
+
+
+		/*
+			Concatenates tree _a_ with tree _b_. The trees can have different heights, be relaxed and have partial
+			leaf nodes. O(log n). Returns the new tree.
+
+			out_shift: shift of the new tree.
+		*/
+		template <class T, class RC>
+		node_ref<T, RC> concat_trees(const node_ref<T, RC>& a, int a_shift, size_t a_count, const node_ref<T, RC>& b, int b_shift, size_t b_count, int& out_shift){
+			STEADY_ASSERT(tree_check_invariant(a, a_count));
+			STEADY_ASSERT(tree_check_invariant(b, b_count));
+
+			if(a_count == 0){
+				out_shift = b_shift;
+				return b;
+			}
+			else if(b_count == 0){
+				out_shift = a_shift;
+				return a;
+			}
+			else{
+				const auto result = concat_sub(counted_node<T, RC>{ a, a_count }, a_shift, counted_node<T, RC>{ b, b_count }, b_shift);
+				out_shift = std::max(a_shift, b_shift) + BRANCHING_FACTOR_SHIFT;
+				return collapse_root(result._node, out_shift);
+			}
+		}
+
+		////////////////////////////////////////////		Comparison
+
+		//	Number of node pairs and blocks find_mismatch() has stepped through on this thread, for tests.
+		inline std::size_t& get_mismatch_step_count(){
+			static thread_local std::size_t count = 0;
+			return count;
+		}
+
+		/*
+			Returns the first position in [begin, end) where subtree _a_ and subtree _b_ differ, or _end_.
+
+			Positions are shared by both trees: _a_ holds the positions [a_start, a_start + a_count), _b_ holds
+			[b_start, b_start + b_count). Both must hold all of [begin, end).
+
+			Walks the two subtrees in parallel, always splitting the taller one, and skips every pair that is the same
+			node at the same position. Comparing two versions of a vector costs O(log n) per difference, not O(n), also
+			when their roots have different heights or their trees start at different offsets. Where the nodes don't
+			line up - after a concatenation, for example - the values are compared leaf node by leaf node.
+
+			COMPARE: value_compare<T> finds values that are not ==, value_order<T> values that are not equivalent.
+		*/
+		template <class T, class RC, class COMPARE = value_compare<T>>
+		size_t find_mismatch(
+			const node_ref<T, RC>& a, int a_shift, size_t a_start, size_t a_count,
+			const node_ref<T, RC>& b, int b_shift, size_t b_start, size_t b_count,
+			size_t begin,
+			size_t end
+		){
+			STEADY_ASSERT(begin <= end);
+			STEADY_ASSERT(a_start <= begin && end <= a_start + a_count);
+			STEADY_ASSERT(b_start <= begin && end <= b_start + b_count);
+
+			get_mismatch_step_count()++;
+			if(begin == end || (a._ptr == b._ptr && a_start == b_start)){
+				return end;
+			}
+			else if(a_shift == LEAF_NODE_SHIFT && b_shift == LEAF_NODE_SHIFT){
+				const T* a_values = &a.get_leaf_node()->get_values()[begin - a_start];
+				const T* b_values = &b.get_leaf_node()->get_values()[begin - b_start];
+				return begin + COMPARE::mismatch(a_values, b_values, end - begin);
+			}
+			else if(a_shift < b_shift){
+				return find_mismatch<T, RC, COMPARE>(b, b_shift, b_start, b_count, a, a_shift, a_start, a_count, begin, end);
+			}
+			else{
+				//	Compare each child of _a_ in [begin, end) with the child of _b_ that lines up with it, or else with _b_.
+				const auto& node = *a.get_inode();
+				size_t index = begin - a_start;
+				auto slot_index = find_child(node, a_shift, index);
+				auto child_start = begin - index;
+				while(child_start < end){
+					const auto child_count = get_child_count(node, a_shift, a_count, slot_index);
+					const auto child_end = std::min(child_start + child_count, end);
+
+					const node_ref<T, RC>* b_node = &b;
+					auto b_node_shift = b_shift;
+					auto b_node_start = b_start;
+					auto b_node_count = b_count;
+					if(b_shift == a_shift && child_start >= b_start && child_start + child_count <= b_start + b_count){
+						const auto& b_inode = *b.get_inode();
+						size_t b_index = child_start - b_start;
+						const auto b_slot_index = find_child(b_inode, b_shift, b_index);
+						const auto b_child_count = get_child_count(b_inode, b_shift, b_count, b_slot_index);
+						if(b_index == 0 && b_child_count == child_count){
+							b_node = &b_inode._children[b_slot_index];
+							b_node_shift = b_shift - BRANCHING_FACTOR_SHIFT;
+							b_node_start = child_start;
+							b_node_count = b_child_count;
+						}
+					}
+
+					const auto m = find_mismatch<T, RC, COMPARE>(
+						node._children[slot_index], a_shift - BRANCHING_FACTOR_SHIFT, child_start, child_count,
+						*b_node, b_node_shift, b_node_start, b_node_count,
+						std::max(begin, child_start),
+						child_end
+					);
+					if(m != child_end){
+						return m;
+					}
+					child_start += child_count;
+					slot_index++;
+				}
+				return end;
+			}
+		}
+
+
+		/*
+			Returns the index of the first value, from _begin_ and on, where vector _a_ and vector _b_ differ. If there
+			is none, returns the size of the shortest vector.
+		*/
+		template <class T, class RC, class COMPARE = value_compare<T>>
+		size_t find_mismatch(const vector<T, RC>& a, const vector<T, RC>& b, size_t begin){
+			const auto count = std::min(a.size(), b.size());
+
+			//	The part where both vectors use their trees: compare the trees hierarchically. Value _index_ of the
+			//	vectors is at position index + offset in both trees.
+			const auto a_tree_count = a.get_tree_size() - a.get_offset();
+			const auto b_tree_count = b.get_tree_size() - b.get_offset();
+			const auto tree_count = std::min(std::min(a_tree_count, b_tree_count), count);
+			size_t index = begin;
+			if(index < tree_count){
+				const auto offset = std::max(a.get_offset(), b.get_offset());
+				const auto m = find_mismatch<T, RC, COMPARE>(
+					a.get_root(), a.get_shift(), offset - a.get_offset(), a.get_tree_size(),
+					b.get_root(), b.get_shift(), offset - b.get_offset(), b.get_tree_size(),
+					offset + index,
+					offset + tree_count
+				);
+				if(m != offset + tree_count){
+					return m - offset;
+				}
+				index = tree_count;
+			}
+
+			//	The rest, including the tails. The vectors can have their values split differently into leaf nodes,
+			//	so step by the shortest block.
+			while(index < count){
+				get_mismatch_step_count()++;
+				size_t count_a = 0;
+				size_t count_b = 0;
+				const T* values_a = a.get_block(index, count_a);
+				const T* values_b = b.get_block(index, count_b);
+
+				const auto r = std::min(std::min(count_a, count_b), count - index);
+				if(values_a != values_b){
+					const auto m = COMPARE::mismatch(values_a, values_b, r);
+					if(m != r){
+						return index + m;
+					}
+				}
+				index += r;
+			}
+			return count;
+		}
+
+
+
+
+		////////////////////////////////////////////		node_ref<T, RC>
+
+		/*
+			Safe, reference counted handle that holds either an inode, a LeadNode or null.
+		*/
+
+		template <typename T, typename RC>
+		node_ref<T, RC>::node_ref() :
+			_ptr(0)
+		{
+			STEADY_ASSERT(check_invariant());
+		}
+
+		/*
+			Will assume ownership of the input node - caller must not delete it after call returns.
+			Adds ref.
+			node == nullptr => null_node
+		*/
+		template <typename T, typename RC>
+		node_ref<T, RC>::node_ref(inode<T, RC>* node) :
+			_ptr(0)
+		{
+			if(node != nullptr){
+				STEADY_ASSERT(node->check_invariant());
+				STEADY_ASSERT(node->_rc >= 0);
+				STEADY_ASSERT((reinterpret_cast<std::uintptr_t>(node) & LEAF_NODE_TAG) == 0);
+
+				_ptr = reinterpret_cast<std::uintptr_t>(node);
+				RC::retain(node);
+			}
+
+			STEADY_ASSERT(check_invariant());
+		}
+
+		/*
+			Will assume ownership of the input node - caller must not delete it after call returns.
+			Adds ref.
+			node == nullptr => null_node
+		*/
+		template <typename T, typename RC>
+		node_ref<T, RC>::node_ref(leaf_node<T, RC>* node) :
+			_ptr(0)
+		{
+			if(node != nullptr){
+				STEADY_ASSERT(node->check_invariant());
+				STEADY_ASSERT(node->_rc >= 0);
+				STEADY_ASSERT((reinterpret_cast<std::uintptr_t>(node) & LEAF_NODE_TAG) == 0);
+
+				_ptr = reinterpret_cast<std::uintptr_t>(node) | LEAF_NODE_TAG;
+				RC::retain(node);
+			}
+
+			STEADY_ASSERT(check_invariant());
+		}
+
+		//	Uses reference counting to share all state.
+		template <typename T, typename RC>
+		node_ref<T, RC>::node_ref(const node_ref<T, RC>& ref) :
+			_ptr(ref._ptr)
+		{
+			STEADY_ASSERT(ref.check_invariant());
+
+			if(_ptr == 0){
+			}
+			else if((_ptr & LEAF_NODE_TAG) == 0){
+				RC::retain(reinterpret_cast<inode<T, RC>*>(_ptr));
+			}
+			else{
+				RC::retain(reinterpret_cast<leaf_node<T, RC>*>(_ptr & ~LEAF_NODE_TAG));
+			}
+
+			STEADY_ASSERT(check_invariant());
+		}
+
+		template <typename T, typename RC>
+		node_ref<T, RC>::node_ref(node_ref<T, RC>&& ref) noexcept :
+			_ptr(ref._ptr)
+		{
+			ref._ptr = 0;
+
+			STEADY_ASSERT(check_invariant());
+		}
+
+		template <typename T, typename RC>
+		node_ref<T, RC>::~node_ref(){
+			STEADY_ASSERT(check_invariant());
+
+			if(_ptr == 0){
+			}
+			else if((_ptr & LEAF_NODE_TAG) == 0){
+				RC::release(reinterpret_cast<inode<T, RC>*>(_ptr));
+			}
+			else{
+				RC::release(reinterpret_cast<leaf_node<T, RC>*>(_ptr & ~LEAF_NODE_TAG));
+			}
+			_ptr = 0;
+		}
+
+		template <typename T, typename RC>
+		bool node_ref<T, RC>::check_invariant() const {
+			if(_ptr == 0){
+			}
+			else if((_ptr & LEAF_NODE_TAG) == 0){
+				const auto node = reinterpret_cast<const inode<T, RC>*>(_ptr);
+				STEADY_ASSERT(node->check_invariant());
+				STEADY_ASSERT(node->_rc > 0);
+			}
+			else{
+				const auto node = reinterpret_cast<const leaf_node<T, RC>*>(_ptr & ~LEAF_NODE_TAG);
+				STEADY_ASSERT(node->check_invariant());
+				STEADY_ASSERT(node->_rc > 0);
+			}
+			return true;
+		}
+
+		template <typename T, typename RC>
+		void node_ref<T, RC>::swap(node_ref<T, RC>& rhs){
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(rhs.check_invariant());
+
+			std::swap(_ptr, rhs._ptr);
+
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(rhs.check_invariant());
+		}
+
+		template <typename T, typename RC>
+		node_ref<T, RC>& node_ref<T, RC>::operator=(const node_ref<T, RC>& rhs){
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(rhs.check_invariant());
+
+			node_ref<T, RC> temp(rhs);
+
+			temp.swap(*this);
+
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(rhs.check_invariant());
+			return *this;
+		}
+
+		//	Our old node is released after _rhs_ is taken over, so _rhs_ can be one of its children.
+		template <typename T, typename RC>
+		node_ref<T, RC>& node_ref<T, RC>::operator=(node_ref<T, RC>&& rhs) noexcept{
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(rhs.check_invariant());
+
+			node_ref<T, RC> temp(std::move(rhs));
+
+			temp.swap(*this);
+
+			STEADY_ASSERT(check_invariant());
+			return *this;
+		}
+
+		template <typename T, typename RC>
+		node_type node_ref<T, RC>::get_type() const {
+			if(_ptr == 0){
+				return node_type::null_node;
+			}
+			else if((_ptr & LEAF_NODE_TAG) == 0){
+				return node_type::inode;
 			}
 			else{
-				STEADY_ASSERT(false);
-				throw nullptr;//	Dummy to stop warning.
+				return node_type::leaf_node;
+			}
+		}
+
+		template <typename T, typename RC>
+		inode<T, RC>* node_ref<T, RC>::get_inode() const {
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(get_type() == node_type::inode);
+
+			return reinterpret_cast<inode<T, RC>*>(_ptr);
+		}
+
+		template <typename T, typename RC>
+		leaf_node<T, RC>* node_ref<T, RC>::get_leaf_node() const {
+			STEADY_ASSERT(check_invariant());
+			STEADY_ASSERT(get_type() == node_type::leaf_node);
+
+			return reinterpret_cast<leaf_node<T, RC>*>(_ptr & ~LEAF_NODE_TAG);
+		}
+
+	}	//	internals
+
+
+
+
+/////////////////////////////////////////////			vector implementation
+
+
+
+template <class T, class RC>
+vector<T, RC>::vector(){
+	STEADY_ASSERT(check_invariant());
+}
+
+
+template <class T, class RC>
+vector<T, RC>::vector(const std::vector<T>& values){
+	//	!!! Illegal to take adress of first element of vec if it's empty.
+	if(values.size() <= INLINE_CAPACITY){
+		if(!values.empty()){
+			append_inline(values.data(), values.size());
+		}
+	}
+	else{
+		auto temp = internals::build_vector<T, RC>(values.data(), values.size());
+		temp.swap(*this);
+	}
+
+	STEADY_ASSERT(size() == values.size());
+	STEADY_ASSERT(check_invariant());
+}
+
+template <class T, class RC>
+vector<T, RC>::vector(std::vector<T>&& values){
+	const auto count = values.size();
+	if(count <= INLINE_CAPACITY){
+		if(count > 0){
+			append_inline<true>(values.data(), count);
+		}
+	}
+	else{
+		auto temp = internals::build_vector<T, RC, true>(values.data(), count);
+		temp.swap(*this);
+	}
+
+	STEADY_ASSERT(size() == count);
+	STEADY_ASSERT(check_invariant());
+}
+
+template <class T, class RC>
+vector<T, RC>::vector(const T values[], size_t count){
+	STEADY_ASSERT(values != nullptr);
+
+	if(count <= INLINE_CAPACITY){
+		append_inline(values, count);
+	}
+	else{
+		auto temp = internals::build_vector<T, RC>(values, count);
+		temp.swap(*this);
+	}
+
+	STEADY_ASSERT(size() == count);
+	STEADY_ASSERT(check_invariant());
+}
+
+
+template <class T, class RC>
+vector<T, RC>::vector(std::initializer_list<T> args){
+	if(args.size() <= INLINE_CAPACITY){
+		append_inline(args.begin(), args.size());
+	}
+	else{
+		auto temp = internals::build_vector<T, RC>(args.begin(), args.size());
+		temp.swap(*this);
+	}
+
+	STEADY_ASSERT(size() == args.size());
+	STEADY_ASSERT(check_invariant());
+}
+
+template <class T, class RC>
+template <class RC2>
+vector<T, RC>::vector(const vector<T, RC2>& rhs){
+	STEADY_ASSERT(rhs.check_invariant());
+
+	if(rhs.size() <= INLINE_CAPACITY){
+		internals::for_each_block(rhs, 0, rhs.size(), [this](const T* values, size_t count){ append_inline(values, count); });
+	}
+	else{
+		auto temp = internals::build_vector<T, RC>(rhs.size(), [&rhs](size_t pos, size_t count, size_t capacity){
+			auto leaf = internals::node_ref<T, RC>(internals::leaf_node<T, RC>::make(capacity));
+			const auto leaf_node = leaf.get_leaf_node();
+			internals::for_each_block(rhs, pos, count, [leaf_node](const T* values, size_t block_count){ leaf_node->append(values, block_count); });
+			return leaf;
+		});
+		temp.swap(*this);
+	}
+
+	STEADY_ASSERT(size() == rhs.size());
+	STEADY_ASSERT(check_invariant());
+}
+
+
+template <class T, class RC>
+vector<T, RC>::~vector(){
+	STEADY_ASSERT(check_invariant());
+
+	if(is_inline()){
+		internals::value_ops<T>::destroy(this->get_inline_values(), _size);
+	}
+#if STEADY_ASSERT_ON
+	_size = -1;
+#endif
+}
+
+
+template <class T, class RC>
+bool vector<T, RC>::check_invariant() const{
+	if(_tail.get_type() == internals::node_type::null_node){
+		STEADY_ASSERT(_size <= INLINE_CAPACITY);
+		STEADY_ASSERT(_tree_size == 0);
+	}
+	else{
+		STEADY_ASSERT(_tail.get_type() == internals::node_type::leaf_node);
+		STEADY_ASSERT(_size + _offset > _tree_size);
+		STEADY_ASSERT(_size + _offset - _tree_size <= BRANCHING_FACTOR);
+		STEADY_ASSERT(_tail.get_leaf_node()->_used >= static_cast<int32_t>(_size + _offset - _tree_size));
+	}
+	STEADY_ASSERT(_tree_size == 0 ? _offset == 0 : _offset < _tree_size);
+	STEADY_ASSERT(tree_check_invariant(_root, _tree_size));
+
+	//	Relaxed trees can be deeper than a regular tree holding the same number of values.
+	STEADY_ASSERT(_shift >= internals::EMPTY_TREE_SHIFT && _shift < 64);
+	if(_tree_size == 0){
+		STEADY_ASSERT(_shift == internals::EMPTY_TREE_SHIFT);
+	}
+	else{
+		STEADY_ASSERT(_shift >= internals::vector_size_to_shift(_tree_size));
+	}
+
+	return true;
+}
+
+
+template <class T, class RC>
+vector<T, RC>::vector(const vector& rhs){
+	STEADY_ASSERT(rhs.check_invariant());
+
+	if(rhs.is_inline()){
+		append_inline(rhs.get_inline_values(), rhs._size);
+	}
+	else{
+		internals::node_ref<T, RC> newRef(rhs._root);
+
+		_root = newRef;
+		_tail = rhs._tail;
+		_tree_size = rhs._tree_size;
+		_offset = rhs._offset;
+		_size = rhs._size;
+		_shift = rhs._shift;
+	}
+
+	STEADY_ASSERT(check_invariant());
+}
+
+
+template <class T, class RC>
+vector<T, RC>& vector<T, RC>::operator=(const vector& rhs){
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+
+	vector<T, RC> temp(rhs);
+	temp.swap(*this);
+
+	STEADY_ASSERT(check_invariant());
+	return *this;
+}
+
+
+template <class T, class RC>
+vector<T, RC>::vector(vector&& rhs) noexcept{
+	STEADY_ASSERT(rhs.check_invariant());
+
+	if(rhs.is_inline()){
+		append_inline(rhs.get_inline_values(), rhs._size);
+		internals::value_ops<T>::destroy(rhs.get_inline_values(), rhs._size);
+		rhs._size = 0;
+	}
+	else{
+		_root = std::move(rhs._root);
+		_tail = std::move(rhs._tail);
+		_tree_size = rhs._tree_size;
+		_offset = rhs._offset;
+		_size = rhs._size;
+		_shift = rhs._shift;
+
+		rhs._tree_size = 0;
+		rhs._offset = 0;
+		rhs._size = 0;
+		rhs._shift = internals::EMPTY_TREE_SHIFT;
+	}
+
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+}
+
+
+template <class T, class RC>
+vector<T, RC>& vector<T, RC>::operator=(vector&& rhs) noexcept{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+
+	vector<T, RC> temp(std::move(rhs));
+	temp.swap(*this);
+
+	STEADY_ASSERT(check_invariant());
+	return *this;
+}
+
+
+template <class T, class RC>
+void vector<T, RC>::swap(vector& rhs){
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+
+	//	Inline values live in the vector objects: they are copied across, via a temporary buffer.
+	if(is_inline() || rhs.is_inline()){
+		typedef internals::value_ops<T> ops_t;
+		const auto count = is_inline() ? _size : 0;
+		const auto rhs_count = rhs.is_inline() ? rhs._size : 0;
+		internals::inline_values<T, INLINE_CAPACITY> temp;
+
+		ops_t::construct_copies(temp.get_inline_values(), this->get_inline_values(), count);
+		ops_t::destroy(this->get_inline_values(), count);
+		ops_t::construct_copies(this->get_inline_values(), rhs.get_inline_values(), rhs_count);
+		ops_t::destroy(rhs.get_inline_values(), rhs_count);
+		ops_t::construct_copies(rhs.get_inline_values(), temp.get_inline_values(), count);
+		ops_t::destroy(temp.get_inline_values(), count);
+	}
+
+	_root.swap(rhs._root);
+	_tail.swap(rhs._tail);
+	std::swap(_tree_size, rhs._tree_size);
+	std::swap(_offset, rhs._offset);
+	std::swap(_size, rhs._size);
+	std::swap(_shift, rhs._shift);
+
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+}
+
+
+template <class T, class RC>
+vector<T, RC>::vector(internals::node_ref<T, RC> root, int shift, std::size_t tree_size, internals::node_ref<T, RC> tail, std::size_t size, std::size_t offset) :
+	_root(std::move(root)),
+	_tail(std::move(tail)),
+	_tree_size(tree_size),
+	_offset(offset),
+	_size(size),
+	_shift(shift)
+{
+	STEADY_ASSERT(shift >= internals::EMPTY_TREE_SHIFT);
+	STEADY_ASSERT(check_invariant());
+}
+
+
+template <class T, class RC>
+int vector<T, RC>::get_shift() const{
+	STEADY_ASSERT(check_invariant());
+
+	return _shift;
+}
+
+
+
+template <class T, class RC>
+size_t vector<T, RC>::get_tree_size() const{
+	STEADY_ASSERT(check_invariant());
+
+	return _tree_size;
+}
+
+template <class T, class RC>
+size_t vector<T, RC>::get_offset() const{
+	STEADY_ASSERT(check_invariant());
+
+	return _offset;
+}
+
+
+template <class T, class RC>
+const T* vector<T, RC>::get_block(size_t index, size_t& out_count) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
+
+	const auto tree_index = index + _offset;
+	if(tree_index >= _tree_size){
+		out_count = _size - index;
+		const T* values = is_inline() ? this->get_inline_values() : _tail.get_leaf_node()->get_values();
+		return &values[tree_index - _tree_size];
+	}
+	else{
+		size_t leaf_index = tree_index;
+		size_t leaf_count = _tree_size;
+		const auto& leaf = internals::find_leaf_node(_root, _shift, leaf_index, leaf_count);
+		out_count = leaf_count - leaf_index;
+		return &leaf.get_leaf_node()->get_values()[leaf_index];
+	}
+}
+
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(const T& value) const&{
+	return emplace_back(value);
+}
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(T&& value) const&{
+	return emplace_back(std::move(value));
+}
+
+template <class T, class RC>
+template <class... ARGS>
+vector<T, RC> vector<T, RC>::emplace_back(ARGS&&... args) const&{
+	STEADY_ASSERT(check_invariant());
+
+	if(INLINE_CAPACITY > 0 && _tail.get_type() == internals::node_type::null_node){
+		return _size < INLINE_CAPACITY ? push_back_inline(std::forward<ARGS>(args)...) : internals::push_back_1(to_tree(_size + 1), std::forward<ARGS>(args)...);
+	}
+	return internals::push_back_1(*this, std::forward<ARGS>(args)...);
+}
+
+
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(const std::vector<T>& values) const&{
+	STEADY_ASSERT(check_invariant());
+	if(values.size() > 0){
+		return push_back(values.data(), values.size());
+	}
+	else {
+		return *this;
+	}
+}
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(std::vector<T>&& values) const&{
+	STEADY_ASSERT(check_invariant());
+	if(values.size() > 0){
+		return push_back_values<true>(values.data(), values.size());
+	}
+	else {
+		return *this;
+	}
+}
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(const T values[], size_t count) const&{
+	return push_back_values<false>(values, count);
+}
+
+template <class T, class RC>
+template <bool MOVE>
+vector<T, RC> vector<T, RC>::push_back_values(internals::source_t<T, MOVE> values, std::size_t count) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(values != nullptr);
+
+	const auto inline_or_empty = _tail.get_type() == internals::node_type::null_node;
+	if(inline_or_empty && _size + count <= INLINE_CAPACITY){
+		vector<T, RC> result(*this);
+		result.template append_inline<MOVE>(values, count);
+		return result;
+	}
+	else if(_size == 0){
+		return internals::build_vector<T, RC, MOVE>(values, count);
+	}
+	else if(inline_or_empty){
+		return internals::push_back_batch<T, RC, MOVE>(to_tree(_size + count), values, count);
+	}
+	return internals::push_back_batch<T, RC, MOVE>(*this, values, count);
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(const T& value) &&{
+	return push_back_unique(value);
+}
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(T&& value) &&{
+	return push_back_unique(std::move(value));
+}
+
+template <class T, class RC>
+template <class... ARGS>
+vector<T, RC> vector<T, RC>::emplace_back(ARGS&&... args) &&{
+	return push_back_unique(std::forward<ARGS>(args)...);
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(const std::vector<T>& values) &&{
+	STEADY_ASSERT(check_invariant());
+	if(values.size() > 0){
+		return std::move(*this).push_back(values.data(), values.size());
+	}
+	else {
+		return std::move(*this);
+	}
+}
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(std::vector<T>&& values) &&{
+	STEADY_ASSERT(check_invariant());
+	if(values.size() > 0){
+		return push_back_values_unique<true>(values.data(), values.size());
+	}
+	else {
+		return std::move(*this);
+	}
+}
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::push_back(const T values[], size_t count) &&{
+	return push_back_values_unique<false>(values, count);
+}
+
+
+/*
+	Fills the tail in place, then moves full leaf nodes into the tree, mutating the uniquely owned inodes on its
+	right edge and the inodes made by earlier leaf nodes of the batch. A unique tail that is too small for the
+	new values is moved to a bigger leaf node.
+*/
+template <class T, class RC>
+template <bool MOVE>
+vector<T, RC> vector<T, RC>::push_back_values_unique(internals::source_t<T, MOVE> values, std::size_t count){
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(values != nullptr);
+
+	const auto& self = *this;
+	if(count == 0 || _tail.get_type() == internals::node_type::null_node){
+		return self.template push_back_values<MOVE>(values, count);
+	}
+
+	const auto edit = internals::new_edit_token();
+	const auto tail_count = _size + _offset - _tree_size;
+	const auto leaf = _tail.get_leaf_node();
+	if(RC::is_unique(leaf)){
+		//	Values after our tail count that no vector uses any more are in the way of claiming.
+		if(static_cast<size_t>(leaf->_used) > tail_count){
+			leaf->truncate(tail_count);
+		}
+		leaf->_edit = edit;
+	}
+
+	if(_tree_size > 0){
+		internals::tag_unique_path(_root, _shift, _tree_size - 1, edit);
+	}
+	auto result = internals::push_back_batch<T, RC, MOVE>(self, values, count, edit);
+
+	//	Our tagged nodes now belong to result.
+	*this = vector<T, RC>();
+	return result;
+}
+
+
+
+
+/*
+	The tail is shared, not copied: the new vector just uses one value less of it. When the tail only has one
+	value we pop the last leaf node out of the tree instead, copying its path, and it becomes the new tail.
+*/
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::pop_back() const&{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(_size > 0);
+
+	const auto tail_count = _size + _offset - _tree_size;
+	if(_size == 1){
+		return vector<T, RC>();
+	}
+	else if(is_inline()){
+		vector<T, RC> result;
+		result.append_inline(this->get_inline_values(), _size - 1);
+		return result;
+	}
+	else if(tail_count > 1){
+		return vector<T, RC>(_root, _shift, _tree_size, _tail, _size - 1, _offset);
+	}
+	else{
+		int shift = _shift;
+		internals::counted_node<T, RC> leaf;
+		auto root = internals::pop_back_leaf_node(_root, shift, _tree_size, internals::NO_EDIT, leaf);
+		const auto tree_size = _tree_size - leaf._count;
+
+		//	The leaf node we popped holds the first values of the vector: the tree has nothing but hidden values left.
+		if(tree_size <= _offset){
+			const auto skip = _offset - tree_size;
+			auto tail = skip > 0 ? internals::drop_tree(leaf._node, internals::LEAF_NODE_SHIFT, leaf._count, skip, internals::NO_EDIT) : std::move(leaf._node);
+			return vector<T, RC>(internals::node_ref<T, RC>(), internals::EMPTY_TREE_SHIFT, 0, std::move(tail), _size - 1, 0);
+		}
+		else{
+			return vector<T, RC>(std::move(root), shift, tree_size, std::move(leaf._node), _size - 1, _offset);
+		}
+	}
+}
+
+
+/*
+	Destructs the popped value right away if we own the tail. When the tail only has one value, the last leaf
+	node is popped out of the tree, editing the inodes on the way in place when we own them.
+*/
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::pop_back() &&{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(_size > 0);
+
+	const auto& self = *this;
+	const auto tail_count = _size + _offset - _tree_size;
+	if(_size == 1 || is_inline()){
+		return self.pop_back();
+	}
+	else if(tail_count > 1){
+		const auto leaf = _tail.get_leaf_node();
+		if(RC::is_unique(leaf)){
+			leaf->truncate(std::min(static_cast<size_t>(leaf->_used), tail_count - 1));
+		}
+		_size--;
+		return std::move(*this);
+	}
+	else{
+		const auto edit = internals::new_edit_token();
+		internals::tag_unique_path(_root, _shift, _tree_size - 1, edit);
+
+		int shift = _shift;
+		internals::counted_node<T, RC> leaf;
+		auto root = internals::pop_back_leaf_node(_root, shift, _tree_size, edit, leaf);
+		const auto tree_size = _tree_size - leaf._count;
+
+		if(tree_size <= _offset){
+			const auto skip = _offset - tree_size;
+			auto tail = skip > 0 ? internals::drop_tree(leaf._node, internals::LEAF_NODE_SHIFT, leaf._count, skip, internals::NO_EDIT) : std::move(leaf._node);
+			auto result = vector<T, RC>(internals::node_ref<T, RC>(), internals::EMPTY_TREE_SHIFT, 0, std::move(tail), _size - 1, 0);
+
+			//	The path in _root may have been edited in place: leave this empty rather than half-popped.
+			*this = vector<T, RC>();
+			return result;
+		}
+		else{
+			_root = std::move(root);
+			_shift = shift;
+			_tree_size = tree_size;
+			_tail = std::move(leaf._node);
+			_size--;
+			return std::move(*this);
+		}
+	}
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::take(std::size_t count) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(count <= _size);
+
+	return subvec(0, count);
+}
+
+
+/*
+	The values before the new start are hidden using the offset. Whenever that hides entire leaf nodes the
+	tree is trimmed, so a sliding window - push_back() at the end, drop_front() at the start - holds on to at
+	most one leaf node of dropped values. Dropping one value at a time costs one path copy per leaf node.
+*/
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::drop_front(std::size_t count) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(count <= _size);
+
+	return subvec(count, _size, true);
+}
+
+
+/*
+	Shared nodes are skipped without looking at their values, so comparing two versions of a vector costs
+	O(log n) per difference.
+*/
+template <class T, class RC>
+bool vector<T, RC>::operator==(const vector& rhs) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+
+	if(_size != rhs._size){
+		return false;
+	}
+	return internals::find_mismatch(*this, rhs, 0) == _size;
+}
+
+
+template <class T, class RC>
+bool vector<T, RC>::operator<(const vector& rhs) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(rhs.check_invariant());
+
+	const auto index = internals::find_mismatch<T, RC, internals::value_order<T>>(*this, rhs, 0);
+	if(index < _size && index < rhs._size){
+		return operator[](index) < rhs[index];
+	}
+	else{
+		return _size < rhs._size;
+	}
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::store(size_t index, const T& value) const&{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
+
+	const auto tree_index = index + _offset;
+	if(is_inline()){
+		return store_inline(index, value);
+	}
+	else if(tree_index >= _tree_size){
+		auto tail = internals::replace_tail_value(_tail, _size + _offset - _tree_size, tree_index - _tree_size, value);
+		return vector<T, RC>(_root, _shift, _tree_size, std::move(tail), _size, _offset);
+	}
+	else{
+		auto root = internals::replace_value(_root, _shift, _tree_size, tree_index, value, internals::NO_EDIT);
+		return vector<T, RC>(std::move(root), _shift, _tree_size, _tail, _size, _offset);
+	}
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::store(size_t index, T&& value) const&{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
+
+	const auto tree_index = index + _offset;
+	if(is_inline()){
+		return store_inline(index, std::forward<T>(value));
+	}
+	else if(tree_index >= _tree_size){
+		auto tail = internals::replace_tail_value(_tail, _size + _offset - _tree_size, tree_index - _tree_size, std::forward<T>(value));
+		return vector<T, RC>(_root, _shift, _tree_size, std::move(tail), _size, _offset);
+	}
+	else{
+		auto root = internals::replace_value(_root, _shift, _tree_size, tree_index, std::forward<T>(value), internals::NO_EDIT);
+		return vector<T, RC>(std::move(root), _shift, _tree_size, _tail, _size, _offset);
+	}
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::store(size_t index, const T& value) &&{
+	return store_unique(index, value);
+}
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::store(size_t index, T&& value) &&{
+	return store_unique(index, std::move(value));
+}
+
+
+template <class T, class RC>
+std::size_t vector<T, RC>::size() const{
+	STEADY_ASSERT(check_invariant());
+	return _size;
+}
+
+
+#if 0
+
+//	Correct, reference implementation.
+template <class T, class RC>
+T vector<T, RC>::operator[](const std::size_t index) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
+
+	size_t count = 0;
+	const T* values = get_block(index, count);
+	const T result = values[0];
+	return result;
+}
+
+#else
+
+/*
+Speed-optimized implementation of operator[].
+Avoids updating reference counters, avoids function calls etc.
+*/
+template <class T, class RC>
+const T& vector<T, RC>::operator[](const std::size_t index) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
+
+	auto leaf_index = index + _offset;
+	if(leaf_index >= _tree_size){
+		const T* values = is_inline() ? this->get_inline_values() : _tail.get_leaf_node()->get_values();
+		return values[leaf_index - _tree_size];
+	}
+
+	auto shift = _shift;
+	const internals::node_ref<T, RC>* node_it = &_root;
+
+	//	Traverse all inodes. Regular inodes use the radix directly, relaxed inodes their size table.
+	while(shift > 0){
+		const auto& node = *node_it->get_inode();
+		size_t slot_index = leaf_index >> shift;
+		if(node._sizes == nullptr){
+			leaf_index -= slot_index << shift;
+		}
+		else{
+			slot_index = internals::find_child(node, shift, leaf_index);
+		}
+		node_it = &node._children[slot_index];
+		shift -= BRANCHING_FACTOR_SHIFT;
+	}
+
+	STEADY_ASSERT(shift == internals::LEAF_NODE_SHIFT);
+	STEADY_ASSERT(node_it->get_type() == internals::node_type::leaf_node);
+	STEADY_ASSERT(leaf_index < BRANCHING_FACTOR);
+
+	const auto& result = node_it->get_leaf_node()->get_values()[leaf_index];
+	return result;
+}
+
+#endif
+
+
+#if 0
+
+//	Correct but slow reference implementation.
+template <class T, class RC>
+std::vector<T> vector<T, RC>::to_vec() const{
+	STEADY_ASSERT(check_invariant());
+
+	std::vector<T> result;
+	result.reserve(size());
+
+	for(size_t i = 0 ; i < size() ; i++){
+		const auto value = operator[](i);
+		result.push_back(value);
+	}
+
+	return result;
+}
+
+#else
+
+template <class T, class RC>
+std::vector<T> vector<T, RC>::to_vec() const{
+	STEADY_ASSERT(check_invariant());
+
+	std::vector<T> result;
+	result.reserve(size());
+
+	//	Block-wise copy.
+	size_t index = 0;
+	while(index < _size){
+		size_t count = 0;
+		const T* values_a = get_block(index, count);
+		result.insert(result.end(), values_a, values_a + count);
+		index += count;
+	}
+	return result;
+}
+
+#endif
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::subvec(std::size_t begin, std::size_t end, bool trim) const{
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(begin <= end);
+	STEADY_ASSERT(end <= _size);
+
+	if(begin == end){
+		return vector<T, RC>();
+	}
+	if(begin == 0 && end == _size && (trim == false || _offset == 0)){
+		return *this;
+	}
+	if(is_inline()){
+		vector<T, RC> result;
+		result.append_inline(this->get_inline_values() + begin, end - begin);
+		return result;
+	}
+
+	const auto tree_begin = begin + _offset;
+	const auto tree_end = end + _offset;
+
+	internals::node_ref<T, RC> root;
+	int shift = internals::EMPTY_TREE_SHIFT;
+	size_t tree_size = 0;
+	internals::node_ref<T, RC> tail;
+
+	//	Find the leaf node holding the last value. It becomes our tail. It is shared even if we only use the start of it.
+	internals::node_ref<T, RC> last_leaf;
+	size_t last_leaf_start = 0;
+	if(tree_end > _tree_size){
+		last_leaf = _tail;
+		last_leaf_start = _tree_size;
+	}
+	else{
+		size_t leaf_index = tree_end - 1;
+		size_t leaf_count = _tree_size;
+		last_leaf = internals::find_leaf_node(_root, _shift, leaf_index, leaf_count);
+		last_leaf_start = tree_end - 1 - leaf_index;
+	}
+
+	if(tree_begin > last_leaf_start){
+		//	All values are inside one leaf node, but not at its start. Copy them, inline if they fit.
+		const T* values = &last_leaf.get_leaf_node()->get_values()[tree_begin - last_leaf_start];
+		if(end - begin <= INLINE_CAPACITY){
+			vector<T, RC> result;
+			result.append_inline(values, end - begin);
+			return result;
+		}
+		tail = internals::make_leaf_node<T, RC>(values, end - begin);
+	}
+	else{
+		tail = last_leaf;
+		if(tree_begin < last_leaf_start){
+			tree_size = last_leaf_start;
+			shift = _shift;
+			root = tree_size == _tree_size ? _root : internals::take_tree(_root, _shift, _tree_size, tree_size, internals::NO_EDIT);
+			root = internals::collapse_root(root, shift);
+
+			if(trim){
+				//	Cut the tree at the start of the leaf node holding _begin_: that leaf node isn't copied.
+				const auto cut = internals::get_leaf_start(root, shift, tree_size, tree_begin);
+				if(cut > 0){
+					root = internals::drop_tree(root, shift, tree_size, cut, internals::NO_EDIT);
+					root = internals::collapse_root(root, shift);
+					tree_size -= cut;
+				}
+				return vector<T, RC>(std::move(root), shift, tree_size, std::move(tail), end - begin, tree_begin - cut);
 			}
+			return vector<T, RC>(std::move(root), shift, tree_size, std::move(tail), end - begin, tree_begin);
 		}
+	}
+	return vector<T, RC>(std::move(root), shift, tree_size, std::move(tail), end - begin, 0);
+}
 
-		template <typename T>
-		const inode<T>* node_ref<T>::get_inode() const {
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(get_type() == node_type::inode);
 
-			return _inode;
+template <class T, class RC>
+void vector<T, RC>::trace_internals() const{
+	STEADY_ASSERT(check_invariant());
+
+	STEADY_TRACE_SS("Vector (size: " << _size << ", offset: " << _offset << (is_inline() ? ", inline" : "") << ") "
+		"total inodes: " << (internals::inode<T, RC>::_debug_count) << ", "
+		"total leaf nodes: " << (internals::leaf_node<T, RC>::_debug_count));
+
+	trace_node("", _root);
+	trace_node("tail: ", _tail);
+}
+
+
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::to_tree(std::size_t reserve) const{
+	STEADY_ASSERT(check_invariant());
+
+	if(!is_inline()){
+		return *this;
+	}
+	const auto capacity = internals::leaf_capacity(std::min(std::max(reserve, _size), static_cast<std::size_t>(BRANCHING_FACTOR)));
+	auto tail = internals::make_leaf_node<T, RC>(this->get_inline_values(), _size, capacity);
+	return vector<T, RC>(internals::node_ref<T, RC>(), internals::EMPTY_TREE_SHIFT, 0, std::move(tail), _size, 0);
+}
+
+
+template <class T, class RC>
+template <bool MOVE>
+void vector<T, RC>::append_inline(internals::source_t<T, MOVE> values, std::size_t count){
+	STEADY_ASSERT(_size == 0 || is_inline());
+	STEADY_ASSERT(_size + count <= INLINE_CAPACITY);
+
+	internals::value_ops<T>::construct(this->get_inline_values() + _size, values, count, std::integral_constant<bool, MOVE>());
+	_size += count;
+
+	STEADY_ASSERT(check_invariant());
+}
+
+
+template <class T, class RC>
+template <class... ARGS>
+vector<T, RC> vector<T, RC>::push_back_inline(ARGS&&... args) const{
+	STEADY_ASSERT(_size < INLINE_CAPACITY);
+
+	vector<T, RC> result(*this);
+	::new (static_cast<void*>(result.get_inline_values() + _size)) T(std::forward<ARGS>(args)...);
+	result._size++;
+	return result;
+}
+
+
+template <class T, class RC>
+template <class... ARGS>
+vector<T, RC> vector<T, RC>::push_back_unique(ARGS&&... args){
+	STEADY_ASSERT(check_invariant());
+
+	const auto& self = *this;
+	if(_tail.get_type() == internals::node_type::null_node){
+		return self.emplace_back(std::forward<ARGS>(args)...);
+	}
+
+	const auto tail_count = _size + _offset - _tree_size;
+	if(tail_count < BRANCHING_FACTOR){
+		const auto leaf = _tail.get_leaf_node();
+
+		//	Values after our tail count that no vector uses any more are in the way of claiming.
+		const auto unique = RC::is_unique(leaf);
+		if(unique && static_cast<size_t>(leaf->_used) > tail_count){
+			leaf->truncate(tail_count);
+		}
+		if(leaf->claim(tail_count, 1)){
+			try {
+				new (leaf->get_values() + tail_count) T(std::forward<ARGS>(args)...);
+			}
+			catch(...){
+				leaf->unclaim(tail_count, 1);
+				throw;
+			}
+			_size++;
+			return std::move(*this);
 		}
 
-		template <typename T>
-		const leaf_node<T>* node_ref<T>::get_leaf_node() const {
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(get_type() == node_type::leaf_node);
+		//	The tail needs to grow. Nobody else sees its values: move them to the bigger leaf node.
+		if(unique){
+			auto tail = internals::make_leaf_node<T, RC, true>(leaf->get_values(), tail_count, internals::tail_capacity(_tree_size, tail_count + 1));
+			tail.get_leaf_node()->push(std::forward<ARGS>(args)...);
+			_tail = std::move(tail);
+			_size++;
+			return std::move(*this);
+		}
 
-			return _leaf_node;
+		//	Another vector uses the next value: copy the tail.
+		return self.emplace_back(std::forward<ARGS>(args)...);
+	}
+	else{
+		const auto edit = internals::new_edit_token();
+		if(_tree_size > 0){
+			internals::tag_unique_path(_root, _shift, _tree_size - 1, edit);
 		}
 
-		template <typename T>
-		leaf_node<T>* node_ref<T>::get_leaf_node() {
-			STEADY_ASSERT(check_invariant());
-			STEADY_ASSERT(get_type() == node_type::leaf_node);
+		auto tail = internals::emplace_leaf_node<T, RC>(BRANCHING_FACTOR, std::forward<ARGS>(args)...);
+		int shift = _shift;
+		_root = internals::push_back_leaf_node(_root, shift, _tree_size, internals::counted_node<T, RC>{ _tail, tail_count }, edit);
+		_shift = shift;
+		_tree_size += tail_count;
+		_tail = std::move(tail);
+		_size++;
+		return std::move(*this);
+	}
+}
+
+
+template <class T, class RC>
+template <class U>
+vector<T, RC> vector<T, RC>::store_unique(std::size_t index, U&& value){
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
 
-			return _leaf_node;
+	const auto& self = *this;
+	const auto tree_index = index + _offset;
+	if(is_inline()){
+		return self.store(index, std::forward<U>(value));
+	}
+	else if(tree_index >= _tree_size){
+		const auto leaf = _tail.get_leaf_node();
+		if(RC::is_unique(leaf)){
+			leaf->get_values()[tree_index - _tree_size] = std::forward<U>(value);
+			return std::move(*this);
 		}
+		return self.store(index, std::forward<U>(value));
+	}
+	else{
+		const auto edit = internals::new_edit_token();
+		internals::tag_unique_path(_root, _shift, tree_index, edit);
+		_root = internals::replace_value(_root, _shift, _tree_size, tree_index, std::forward<U>(value), edit);
+		return std::move(*this);
+	}
+}
 
-	}	//	internals
 
+//	Copies the values before and after _index_ around the new value, so T needs no copy assignment.
+template <class T, class RC>
+template <class U>
+vector<T, RC> vector<T, RC>::store_inline(std::size_t index, U&& value) const{
+	STEADY_ASSERT(is_inline());
+	STEADY_ASSERT(index < _size);
+
+	vector<T, RC> result;
+	result.append_inline(this->get_inline_values(), index);
+	::new (static_cast<void*>(result.get_inline_values() + index)) T(std::forward<U>(value));
+	result._size++;
+	result.append_inline(this->get_inline_values() + index + 1, _size - index - 1);
+	return result;
+}
 
 
 
-/////////////////////////////////////////////			vector implementation
+/////////////////////////////////////////////			vector::transient implementation
 
 
 
-template <class T>
-vector<T>::vector(){
+template <class T, class RC>
+vector<T, RC>::transient::transient() :
+	_edit(internals::new_edit_token())
+{
 	STEADY_ASSERT(check_invariant());
 }
 
+template <class T, class RC>
+vector<T, RC>::transient::transient(const vector<T, RC>& original) :
+	_root(original._root),
+	_tail(original._tail),
+	_tree_size(original._tree_size),
+	_offset(original._offset),
+	_size(original._size),
+	_shift(original._shift),
+	_edit(internals::new_edit_token())
+{
+	STEADY_ASSERT(original.check_invariant());
 
-template <class T>
-vector<T>::vector(const std::vector<T>& values){
-	//	!!! Illegal to take adress of first element of vec if it's empty.
-	if(!values.empty()){
-		auto temp = internals::push_back_batch(vector<T>(), values.data(), values.size());
-		temp.swap(*this);
+	if(original.is_inline()){
+		_tail = original.to_tree().get_tail();
 	}
-
-	STEADY_ASSERT(size() == values.size());
 	STEADY_ASSERT(check_invariant());
 }
 
-template <class T>
-vector<T>::vector(const T values[], size_t count){
-	STEADY_ASSERT(values != nullptr);
+template <class T, class RC>
+bool vector<T, RC>::transient::check_invariant() const{
+	STEADY_ASSERT(_edit != internals::NO_EDIT);
+	STEADY_ASSERT(_tail.get_type() == (_size == 0 ? internals::node_type::null_node : internals::node_type::leaf_node));
+	STEADY_ASSERT(_size == 0 ? _tree_size == 0 : (_size + _offset > _tree_size && _size + _offset - _tree_size <= BRANCHING_FACTOR));
+	STEADY_ASSERT(_tree_size == 0 ? _offset == 0 : _offset < _tree_size);
+	STEADY_ASSERT(tree_check_invariant(_root, _tree_size));
+	STEADY_ASSERT(_tree_size == 0 ? _shift == internals::EMPTY_TREE_SHIFT : _shift >= internals::vector_size_to_shift(_tree_size));
+	return true;
+}
 
-	auto temp = internals::push_back_batch(vector<T>(), values, count);
-	temp.swap(*this);
+template <class T, class RC>
+std::size_t vector<T, RC>::transient::size() const{
+	STEADY_ASSERT(check_invariant());
+	return _size;
+}
 
-	STEADY_ASSERT(size() == count);
+template <class T, class RC>
+const T& vector<T, RC>::transient::operator[](std::size_t index) const{
 	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
+
+	size_t leaf_index = index + _offset;
+	if(leaf_index >= _tree_size){
+		return _tail.get_leaf_node()->get_values()[leaf_index - _tree_size];
+	}
+
+	size_t leaf_count = _tree_size;
+	const auto& leaf = internals::find_leaf_node(_root, _shift, leaf_index, leaf_count);
+	return leaf.get_leaf_node()->get_values()[leaf_index];
 }
 
+template <class T, class RC>
+template <class U>
+void vector<T, RC>::transient::store_internal(size_t index, U&& value){
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(index < _size);
 
-template <class T>
-vector<T>::vector(std::initializer_list<T> args){
-	auto temp = internals::push_back_batch(vector<T>(), args.begin(), args.end() - args.begin());
-	temp.swap(*this);
+	const auto tree_index = index + _offset;
+	if(tree_index >= _tree_size){
+		_tail = internals::make_editable_leaf_node(_tail, _size + _offset - _tree_size, _edit);
+		_tail.get_leaf_node()->get_values()[tree_index - _tree_size] = std::forward<U>(value);
+	}
+	else{
+		_root = internals::replace_value(_root, _shift, _tree_size, tree_index, std::forward<U>(value), _edit);
+	}
 
-	STEADY_ASSERT(size() == args.size());
 	STEADY_ASSERT(check_invariant());
 }
 
+template <class T, class RC>
+void vector<T, RC>::transient::store(size_t index, const T& value){
+	store_internal(index, value);
+}
 
-template <class T>
-vector<T>::~vector(){
-	STEADY_ASSERT(check_invariant());
-#if STEADY_ASSERT_ON
-	_size = -1;
-#endif
+template <class T, class RC>
+void vector<T, RC>::transient::store(size_t index, T&& value){
+	store_internal(index, std::move(value));
 }
 
+template <class T, class RC>
+template <class... ARGS>
+void vector<T, RC>::transient::push_back_internal(ARGS&&... args){
+	STEADY_ASSERT(check_invariant());
+
+	const auto tail_count = _size + _offset - _tree_size;
 
-template <class T>
-bool vector<T>::check_invariant() const{
-	if(_root.get_type() == internals::node_type::null_node){
-		STEADY_ASSERT(_size == 0);
+	if(_size > 0 && tail_count < BRANCHING_FACTOR){
+		auto tail = internals::make_editable_leaf_node(_tail, tail_count, _edit, internals::tail_capacity(_tree_size, tail_count + 1));
+		STEADY_ASSERT(tail.get_leaf_node()->_used == static_cast<int32_t>(tail_count));
+		tail.get_leaf_node()->push(std::forward<ARGS>(args)...);
+		_tail = std::move(tail);
 	}
 	else{
-		STEADY_ASSERT(_size >= 0);
+		auto tail = internals::emplace_leaf_node<T, RC>(_size == 0 ? 1 : BRANCHING_FACTOR, std::forward<ARGS>(args)...);
+		tail.get_leaf_node()->_edit = _edit;
+		if(_size > 0){
+			_root = internals::push_back_leaf_node(_root, _shift, _tree_size, internals::counted_node<T, RC>{ _tail, tail_count }, _edit);
+			_tree_size += tail_count;
+		}
+		_tail = std::move(tail);
 	}
-	STEADY_ASSERT(tree_check_invariant(_root, _size));
+	_size++;
 
-	STEADY_ASSERT(_shift >= internals::EMPTY_TREE_SHIFT && _shift < 32);
-	STEADY_ASSERT(_shift == internals::vector_size_to_shift(_size));
+	STEADY_ASSERT(check_invariant());
+}
 
-	return true;
+template <class T, class RC>
+void vector<T, RC>::transient::push_back(const T& value){
+	push_back_internal(value);
+}
+
+template <class T, class RC>
+void vector<T, RC>::transient::push_back(T&& value){
+	push_back_internal(std::move(value));
 }
 
+template <class T, class RC>
+template <class... ARGS>
+void vector<T, RC>::transient::emplace_back(ARGS&&... args){
+	push_back_internal(std::forward<ARGS>(args)...);
+}
 
-template <class T>
-vector<T>::vector(const vector& rhs){
-	STEADY_ASSERT(rhs.check_invariant());
+template <class T, class RC>
+void vector<T, RC>::transient::pop_back(){
+	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(_size > 0);
 
-	internals::node_ref<T> newRef(rhs._root);
+	const auto tail_count = _size + _offset - _tree_size;
 
-	_root = newRef;
-	_size = rhs._size;
-	_shift = rhs._shift;
+	if(tail_count > 1){
+		//	Release the popped value right away if we own the tail.
+		if(_tail.get_leaf_node()->_edit == _edit){
+			STEADY_ASSERT(_tail.get_leaf_node()->_used == static_cast<int32_t>(tail_count));
+			_tail.get_leaf_node()->pop();
+		}
+	}
+	else if(_tree_size == 0){
+		_tail = internals::node_ref<T, RC>();
+	}
+	else{
+		internals::counted_node<T, RC> leaf;
+		_root = internals::pop_back_leaf_node(_root, _shift, _tree_size, _edit, leaf);
+		_tree_size -= leaf._count;
+		_tail = leaf._node;
+
+		//	The leaf node we popped holds the first values of the vector: the tree has nothing but hidden values left.
+		if(_tree_size <= _offset){
+			const auto skip = _offset - _tree_size;
+			if(skip > 0){
+				_tail = internals::drop_tree(leaf._node, internals::LEAF_NODE_SHIFT, leaf._count, skip, _edit);
+			}
+			_root = internals::node_ref<T, RC>();
+			_shift = internals::EMPTY_TREE_SHIFT;
+			_tree_size = 0;
+			_offset = 0;
+		}
+	}
+	_size--;
 
 	STEADY_ASSERT(check_invariant());
 }
 
-
-template <class T>
-vector<T>& vector<T>::operator=(const vector& rhs){
+template <class T, class RC>
+vector<T, RC> vector<T, RC>::transient::persistent(){
 	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(rhs.check_invariant());
 
-	vector<T> temp(rhs);
-	temp.swap(*this);
+	//	From now on the nodes are shared with an immutable vector: start a new edit session.
+	_edit = internals::new_edit_token();
 
-	STEADY_ASSERT(check_invariant());
-	return *this;
+	return vector<T, RC>(_root, _shift, _tree_size, _tail, _size, _offset);
 }
 
 
-template <class T>
-void vector<T>::swap(vector& rhs){
-	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(rhs.check_invariant());
 
-	_root.swap(rhs._root);
-	std::swap(_size, rhs._size);
-	std::swap(_shift, rhs._shift);
+/////////////////////////////////////////////			vector::const_iterator implementation
+
+
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator vector<T, RC>::begin() const{
 	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(rhs.check_invariant());
+	return const_iterator(this, 0);
 }
 
-
-template <class T>
-vector<T>::vector(internals::node_ref<T> root, std::size_t size, int shift) :
-	_root(root),
-	_size(size),
-	_shift(shift)
-{
-	STEADY_ASSERT(shift >= internals::EMPTY_TREE_SHIFT);
-	STEADY_ASSERT(internals::vector_size_to_shift(size) == shift);
+template <class T, class RC>
+typename vector<T, RC>::const_iterator vector<T, RC>::end() const{
 	STEADY_ASSERT(check_invariant());
+	return const_iterator(this, _size);
 }
 
 
-template <class T>
-int vector<T>::get_shift() const{
+template <class T, class RC>
+vector<T, RC>::const_iterator::const_iterator(){
 	STEADY_ASSERT(check_invariant());
-
-	return _shift;
 }
 
+template <class T, class RC>
+vector<T, RC>::const_iterator::const_iterator(const vector<T, RC>* vec, std::size_t index) :
+	_vector(vec),
+	_index(index)
+{
+	STEADY_ASSERT(vec != nullptr);
+	STEADY_ASSERT(index <= vec->size());
 
-
-template <class T>
-size_t vector<T>::get_block_count() const{
+	update_block();
 	STEADY_ASSERT(check_invariant());
+}
+
+template <class T, class RC>
+bool vector<T, RC>::const_iterator::check_invariant() const{
+	STEADY_ASSERT(_block_begin <= _block_end);
+	STEADY_ASSERT(_block == nullptr || _block_end > _block_begin);
+	STEADY_ASSERT(_vector == nullptr || _index <= _vector->size());
+	return true;
+}
 
-	const size_t count = internals::divide_round_up(_size, BRANCHING_FACTOR);
-	return count;
+template <class T, class RC>
+void vector<T, RC>::const_iterator::update_block(){
+	if((_index < _block_begin || _index >= _block_end) && _index < _vector->size()){
+		size_t count = 0;
+		_block = _vector->get_block(_index, count);
+		_block_begin = _index;
+		_block_end = _index + count;
+	}
 }
 
-template <class T>
-const T* vector<T>::get_block(size_t block_index) const{
+template <class T, class RC>
+typename vector<T, RC>::const_iterator::reference vector<T, RC>::const_iterator::operator*() const{
 	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(get_block_count() > 0);
-	STEADY_ASSERT(block_index < get_block_count());
+	STEADY_ASSERT(_index >= _block_begin && _index < _block_end);
 
-	const auto leaf = internals::find_leaf_node(*this, block_index * BRANCHING_FACTOR);
-	return &leaf.get_leaf_node()->_values[0];
+	return _block[_index - _block_begin];
 }
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator::pointer vector<T, RC>::const_iterator::operator->() const{
+	return &operator*();
+}
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator::reference vector<T, RC>::const_iterator::operator[](difference_type n) const{
+	const auto index = _index + n;
+	if(index >= _block_begin && index < _block_end){
+		return _block[index - _block_begin];
+	}
+	else{
+		return (*_vector)[index];
+	}
+}
 
-template <class T>
-vector<T> vector<T>::push_back(const T& value) const{
-	STEADY_ASSERT(check_invariant());
-	return internals::push_back_1(*this, value);
+template <class T, class RC>
+typename vector<T, RC>::const_iterator& vector<T, RC>::const_iterator::operator++(){
+	_index++;
+	update_block();
+	return *this;
 }
-template <class T>
-vector<T> vector<T>::push_back(T&& value) const {
-	STEADY_ASSERT(check_invariant());
-	return internals::push_back_1(*this, std::forward<T>(value));
+
+template <class T, class RC>
+typename vector<T, RC>::const_iterator vector<T, RC>::const_iterator::operator++(int){
+	const auto temp = *this;
+	operator++();
+	return temp;
 }
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator& vector<T, RC>::const_iterator::operator--(){
+	STEADY_ASSERT(_index > 0);
+	_index--;
+	update_block();
+	return *this;
+}
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator vector<T, RC>::const_iterator::operator--(int){
+	const auto temp = *this;
+	operator--();
+	return temp;
+}
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator& vector<T, RC>::const_iterator::operator+=(difference_type n){
+	_index += n;
+	STEADY_ASSERT(_index <= _vector->size());
+	update_block();
+	return *this;
+}
 
-template <class T>
-vector<T> vector<T>::push_back(const std::vector<T>& values) const{
-	STEADY_ASSERT(check_invariant());
-	if(values.size() > 0){
-		return internals::push_back_batch<T>(*this, values.data(), values.size());
-	}
-	else {
-		return *this;
-	}
+template <class T, class RC>
+typename vector<T, RC>::const_iterator& vector<T, RC>::const_iterator::operator-=(difference_type n){
+	return operator+=(-n);
 }
 
-template <class T>
-vector<T> vector<T>::push_back(const T values[], size_t count) const {
-	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(values != nullptr);
+template <class T, class RC>
+typename vector<T, RC>::const_iterator vector<T, RC>::const_iterator::operator+(difference_type n) const{
+	auto temp = *this;
+	temp += n;
+	return temp;
+}
 
-	return internals::push_back_batch(*this, values, count);
+template <class T, class RC>
+typename vector<T, RC>::const_iterator vector<T, RC>::const_iterator::operator-(difference_type n) const{
+	auto temp = *this;
+	temp -= n;
+	return temp;
 }
 
+template <class T, class RC>
+typename vector<T, RC>::const_iterator::difference_type vector<T, RC>::const_iterator::operator-(const const_iterator& rhs) const{
+	return static_cast<difference_type>(_index) - static_cast<difference_type>(rhs._index);
+}
 
 
 
 
 
-/*
-	### Correct but inefficient.
-*/
-template <class T>
-vector<T> vector<T>::pop_back() const{
-	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(_size > 0);
+/////////////////////////////////////////////			vector_view implementation
 
-	const auto temp = to_vec();
-	const auto result = vector<T>(&temp[0], _size - 1);
-	return result;
-}
 
 
-/*
-	Correct but inefficient.
-*/
-#if 0
-template <class T>
-bool vector<T>::operator==(const vector& rhs) const{
+template <class T, class RC>
+vector_view<T, RC>::vector_view(){
 	STEADY_ASSERT(check_invariant());
-
-	const auto a = to_vec();
-	const auto b = rhs.to_vec();
-	return a == b;
 }
 
-#else
-
-template <class T>
-bool vector<T>::operator==(const vector& rhs) const{
-	STEADY_ASSERT(check_invariant());
+template <class T, class RC>
+vector_view<T, RC>::vector_view(const vector<T, RC>& vec) :
+	vector_view(vec, 0, vec.size())
+{
+}
 
-	if(_size != rhs._size){
-		return false;
-	}
-	if(_size == 0){
-		return true;
-	}
+template <class T, class RC>
+vector_view<T, RC>::vector_view(const vector<T, RC>& vec, std::size_t begin, std::size_t end) :
+	_tree_size(vec.get_tree_size()),
+	_offset(vec.get_offset()),
+	_shift(vec.get_shift()),
+	_vector_size(vec.size()),
+	_begin(begin),
+	_size(end - begin)
+{
+	STEADY_ASSERT(begin <= end && end <= vec.size());
 
-	if(_root.get_type() != rhs._root.get_type()){
-		return false;
-	}
-	if(_root.get_type() == internals::node_type::inode && _root.get_inode() == rhs._root.get_inode()){
-		return true;
+	if(_tree_size > 0){
+		if(_shift == internals::LEAF_NODE_SHIFT){
+			_root_leaf = vec.get_root().get_leaf_node();
+		}
+		else{
+			_root_inode = vec.get_root().get_inode();
+		}
 	}
-	if(_root.get_type() == internals::node_type::leaf_node && _root.get_leaf_node() == rhs._root.get_leaf_node()){
-		return true;
+	if(vec.get_tail().get_type() == internals::node_type::leaf_node){
+		_tail = vec.get_tail().get_leaf_node();
 	}
 
-	//	### optimize by comparing node by node, hiearchically.
-	//	First check node to see if they are the same pointer. If not, only then compare their values.
-
-	{
-		const size_t block_count = get_block_count();
-		for(size_t index = 0 ; index < block_count ; index++){
-			const T* valuesA = get_block(index);
-			const T* valuesB = rhs.get_block(index);
-
-			const size_t r = std::min(static_cast<size_t>(BRANCHING_FACTOR), _size - index * BRANCHING_FACTOR);
-			const bool equal = std::equal(valuesA, valuesA + r, valuesB);
-			if(!equal){
-				return false;
-			}
-		}
+	//	Covers inline vectors too: their values come after the - empty - tree.
+	const auto tail_begin = _tree_size - _offset;
+	if(tail_begin < _vector_size){
+		std::size_t count = 0;
+		_tail_values = vec.get_block(tail_begin, count);
 	}
+	STEADY_ASSERT(check_invariant());
+}
 
+template <class T, class RC>
+bool vector_view<T, RC>::check_invariant() const{
+	STEADY_ASSERT(_root_inode == nullptr || _root_leaf == nullptr);
+	STEADY_ASSERT((_root_inode == nullptr && _root_leaf == nullptr) == (_tree_size == 0));
+	STEADY_ASSERT(_root_leaf == nullptr || _shift == internals::LEAF_NODE_SHIFT);
+	STEADY_ASSERT(_offset <= _tree_size);
+	STEADY_ASSERT(_vector_size >= _tree_size - _offset);
+	STEADY_ASSERT((_tail_values == nullptr) == (_vector_size == _tree_size - _offset));
+	STEADY_ASSERT(_tail == nullptr || _tail_values == _tail->get_values());
+	STEADY_ASSERT(_begin + _size <= _vector_size);
 	return true;
 }
 
-#endif
+template <class T, class RC>
+std::size_t vector_view<T, RC>::size() const{
+	STEADY_ASSERT(check_invariant());
 
+	return _size;
+}
 
-template <class T>
-vector<T> vector<T>::store(size_t index, const T& value) const{
+template <class T, class RC>
+const T& vector_view<T, RC>::operator[](std::size_t index) const{
 	STEADY_ASSERT(check_invariant());
 	STEADY_ASSERT(index < _size);
-	const auto root = replace_value(_root, _shift, index, value);
-	return vector<T>(root, _size, _shift);
-}
 
+	std::size_t count = 0;
+	return *get_block(index, count);
+}
 
-template <class T>
-vector<T> vector<T>::store(size_t index, T&& value) const{
+//	Same lookup as vector::get_block(), starting from the borrowed root instead of a node_ref.
+template <class T, class RC>
+const T* vector_view<T, RC>::get_block(std::size_t index, std::size_t& out_count) const{
 	STEADY_ASSERT(check_invariant());
 	STEADY_ASSERT(index < _size);
-	const auto root = replace_value(_root, _shift, index, std::forward<T>(value));
-	return vector<T>(root, _size, _shift);
-}
 
+	const auto tree_index = _begin + index + _offset;
+	if(tree_index >= _tree_size){
+		out_count = _size - index;
+		return &_tail_values[tree_index - _tree_size];
+	}
+	else{
+		size_t leaf_index = tree_index;
+		size_t leaf_count = _tree_size;
+		const T* values = nullptr;
+		if(_root_leaf != nullptr){
+			values = _root_leaf->get_values();
+		}
+		else{
+			const auto slot_index = internals::find_child(*_root_inode, _shift, leaf_index);
+			leaf_count = internals::get_child_count(*_root_inode, _shift, leaf_count, slot_index);
+			const auto& leaf = internals::find_leaf_node(
+				_root_inode->_children[slot_index],
+				_shift - BRANCHING_FACTOR_SHIFT,
+				leaf_index,
+				leaf_count
+			);
+			values = leaf.get_leaf_node()->get_values();
+		}
+		out_count = std::min(leaf_count - leaf_index, _size - index);
+		return &values[leaf_index];
+	}
+}
 
-template <class T>
-std::size_t vector<T>::size() const{
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator vector_view<T, RC>::begin() const{
 	STEADY_ASSERT(check_invariant());
-	return _size;
+
+	return const_iterator(this, 0);
 }
 
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator vector_view<T, RC>::end() const{
+	STEADY_ASSERT(check_invariant());
 
-#if 0
+	return const_iterator(this, _size);
+}
 
-//	Correct, reference implementation.
-template <class T>
-T vector<T>::operator[](const std::size_t index) const{
+template <class T, class RC>
+vector_view<T, RC> vector_view<T, RC>::subview(std::size_t begin, std::size_t end) const{
 	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(index < _size);
-
-	const auto leaf = internals::find_leaf_node(*this, index);
-	const auto slot_index = index & internals::BRANCHING_FACTOR_MASK;
+	STEADY_ASSERT(begin <= end && end <= _size);
 
-	STEADY_ASSERT(slot_index < leaf.get_leaf_node()->_values.size());
-	const T result = leaf.get_leaf_node()->_values[slot_index];
+	auto result = *this;
+	result._begin = _begin + begin;
+	result._size = end - begin;
+	STEADY_ASSERT(result.check_invariant());
 	return result;
 }
 
-#else
-
-/*
-Speed-optimized implementation of operator[].
-Avoids updating reference counters, avoids function calls etc.
-*/
-template <class T>
-const T& vector<T>::operator[](const std::size_t index) const{
+template <class T, class RC>
+vector<T, RC> vector_view<T, RC>::to_vector() const{
 	STEADY_ASSERT(check_invariant());
-	STEADY_ASSERT(index < _size);
-
-	auto shift = _shift;
-	const internals::node_ref<T>* node_it = &_root;
 
-	//	Traverse all inodes.
-	while(shift > 0){
-		const size_t slot_index = (index >> shift) & internals::BRANCHING_FACTOR_MASK;
-		node_it = &node_it->_inode->_children[slot_index];
-		shift -= BRANCHING_FACTOR_SHIFT;
+	if(_size == 0){
+		return vector<T, RC>();
 	}
 
-	STEADY_ASSERT(shift == internals::LEAF_NODE_SHIFT);
-	STEADY_ASSERT(node_it->get_type() == internals::node_type::leaf_node);
-
-	const auto slot_index = index & internals::BRANCHING_FACTOR_MASK;
-
-	STEADY_ASSERT(slot_index < node_it->get_leaf_node()->_values.size());
-	const auto& result = node_it->_leaf_node->_values[slot_index];
-	return result;
+	//	Inline: the values are in the vector object, not in any node.
+	else if(_tree_size == 0 && _tail == nullptr){
+		return vector<T, RC>(&_tail_values[_begin], _size);
+	}
+	else{
+		const auto root = _root_leaf != nullptr
+			? internals::node_ref<T, RC>(_root_leaf)
+			: internals::node_ref<T, RC>(_root_inode);
+		const vector<T, RC> all(root, _shift, _tree_size, internals::node_ref<T, RC>(_tail), _vector_size, _offset);
+		return all.subvec(_begin, _begin + _size);
+	}
 }
 
-#endif
 
+template <class T, class RC>
+vector_view<T, RC>::const_iterator::const_iterator(){
+	STEADY_ASSERT(check_invariant());
+}
 
-#if 0
+template <class T, class RC>
+vector_view<T, RC>::const_iterator::const_iterator(const vector_view<T, RC>* view, std::size_t index) :
+	_view(view),
+	_index(index)
+{
+	STEADY_ASSERT(view != nullptr);
+	STEADY_ASSERT(index <= view->size());
 
-//	Correct but slow reference implementation.
-template <class T>
-std::vector<T> vector<T>::to_vec() const{
+	update_block();
 	STEADY_ASSERT(check_invariant());
+}
 
-	std::vector<T> result;
-	result.reserve(size());
+template <class T, class RC>
+bool vector_view<T, RC>::const_iterator::check_invariant() const{
+	STEADY_ASSERT(_block_begin <= _block_end);
+	STEADY_ASSERT(_block == nullptr || _block_end > _block_begin);
+	STEADY_ASSERT(_view == nullptr || _index <= _view->size());
+	return true;
+}
 
-	for(size_t i = 0 ; i < size() ; i++){
-		const auto value = operator[](i);
-		result.push_back(value);
+template <class T, class RC>
+void vector_view<T, RC>::const_iterator::update_block(){
+	if((_index < _block_begin || _index >= _block_end) && _index < _view->size()){
+		size_t count = 0;
+		_block = _view->get_block(_index, count);
+		_block_begin = _index;
+		_block_end = _index + count;
 	}
-
-	return result;
 }
 
-#else
-
-template <class T>
-std::vector<T> vector<T>::to_vec() const{
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator::reference vector_view<T, RC>::const_iterator::operator*() const{
 	STEADY_ASSERT(check_invariant());
+	STEADY_ASSERT(_index >= _block_begin && _index < _block_end);
 
-	std::vector<T> result;
-	result.reserve(size());
+	return _block[_index - _block_begin];
+}
 
-	//	Block-wise copy.
-	const auto block_count = get_block_count();
-	for(size_t index = 0 ; index < block_count ; index++){
-		const T* values_a = get_block(index);
-		const auto size = std::min(static_cast<size_t>(BRANCHING_FACTOR), _size - index * BRANCHING_FACTOR);
-		result.insert(result.end(), values_a, values_a + size);
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator::pointer vector_view<T, RC>::const_iterator::operator->() const{
+	return &operator*();
+}
+
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator::reference vector_view<T, RC>::const_iterator::operator[](difference_type n) const{
+	const auto index = _index + n;
+	if(index >= _block_begin && index < _block_end){
+		return _block[index - _block_begin];
+	}
+	else{
+		return (*_view)[index];
 	}
-	return result;
 }
 
-#endif
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator& vector_view<T, RC>::const_iterator::operator++(){
+	_index++;
+	update_block();
+	return *this;
+}
 
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator vector_view<T, RC>::const_iterator::operator++(int){
+	const auto temp = *this;
+	operator++();
+	return temp;
+}
 
-template <class T>
-void vector<T>::trace_internals() const{
-	STEADY_ASSERT(check_invariant());
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator& vector_view<T, RC>::const_iterator::operator--(){
+	STEADY_ASSERT(_index > 0);
+	_index--;
+	update_block();
+	return *this;
+}
 
-	STEADY_TRACE_SS("Vector (size: " << _size << ") "
-		"total inodes: " << internals::inode<T>::_debug_count << ", "
-		"total leaf nodes: " << internals::leaf_node<T>::_debug_count);
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator vector_view<T, RC>::const_iterator::operator--(int){
+	const auto temp = *this;
+	operator--();
+	return temp;
+}
 
-	trace_node("", _root);
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator& vector_view<T, RC>::const_iterator::operator+=(difference_type n){
+	_index += n;
+	STEADY_ASSERT(_index <= _view->size());
+	update_block();
+	return *this;
+}
+
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator& vector_view<T, RC>::const_iterator::operator-=(difference_type n){
+	return operator+=(-n);
+}
+
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator vector_view<T, RC>::const_iterator::operator+(difference_type n) const{
+	auto temp = *this;
+	temp += n;
+	return temp;
+}
+
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator vector_view<T, RC>::const_iterator::operator-(difference_type n) const{
+	auto temp = *this;
+	temp -= n;
+	return temp;
 }
 
+template <class T, class RC>
+typename vector_view<T, RC>::const_iterator::difference_type vector_view<T, RC>::const_iterator::operator-(const const_iterator& rhs) const{
+	return static_cast<difference_type>(_index) - static_cast<difference_type>(rhs._index);
+}
 
 
-//	### Optimization potential here.
-template <class T>
-vector<T> operator+(const vector<T>& a, const vector<T>& b){
-	vector<T> result;
 
-#if 1
-	if(b.empty()){
+/*
+	Concatenates the trees of the two vectors, RRB-style. a's tail is pushed into a's tree first, as a partial
+	leaf node if needed, and b's tail becomes the new tail.
+*/
+template <class T, class RC>
+vector<T, RC> operator+(const vector<T, RC>& a, const vector<T, RC>& b){
+	STEADY_ASSERT(a.check_invariant());
+	STEADY_ASSERT(b.check_invariant());
+
+	vector<T, RC> result;
+	if(a.empty()){
+		result = b;
 	}
-	else{
-		const auto v = b.to_vec();
-		result = internals::push_back_batch(a, &v[0], v.size());
+	else if(b.empty()){
+		result = a;
 	}
-#else
-	for(size_t i = 0 ; i < b.size() ; i++){
-		result = result.push_back(b[i]);
+	else if(b.get_tree_size() == 0){
+		//	b is all tail or inline: cheaper to append its values.
+		size_t count = 0;
+		const T* values = b.get_block(0, count);
+		result = a.push_back(values, count);
+	}
+	else if(a.is_inline()){
+		result = a.to_tree() + b;
+	}
+	else{
+		int a_shift = a.get_shift();
+		const auto a_tail_count = a.size() + a.get_offset() - a.get_tree_size();
+		const auto a_root = internals::push_back_leaf_node(
+			a.get_root(),
+			a_shift,
+			a.get_tree_size(),
+			internals::counted_node<T, RC>{ a.get_tail(), a_tail_count },
+			internals::NO_EDIT
+		);
+		const auto a_count = a.get_tree_size() + a_tail_count;
+
+		//	The hidden values at the start of b's tree must go.
+		int b_shift = b.get_shift();
+		auto b_root = b.get_root();
+		const auto b_count = b.get_tree_size() - b.get_offset();
+		if(b.get_offset() > 0){
+			b_root = internals::drop_tree(b_root, b_shift, b.get_tree_size(), b.get_offset(), internals::NO_EDIT);
+			b_root = internals::collapse_root(b_root, b_shift);
+		}
+
+		int shift = 0;
+		auto root = internals::concat_trees(a_root, a_shift, a_count, b_root, b_shift, b_count, shift);
+		result = vector<T, RC>(std::move(root), shift, a_count + b_count, b.get_tail(), a.size() + b.size(), a.get_offset());
 	}
-#endif
 
 	STEADY_ASSERT(result.size() == a.size() + b.size());
 	return result;
 }
 
 
+template <class T, class RC>
+std::vector<std::pair<std::size_t, std::size_t>> diff(const vector<T, RC>& a, const vector<T, RC>& b){
+	STEADY_ASSERT(a.check_invariant());
+	STEADY_ASSERT(b.check_invariant());
+
+	std::vector<std::pair<std::size_t, std::size_t>> result;
+	const auto count = std::min(a.size(), b.size());
+	const auto max_count = std::max(a.size(), b.size());
+
+	auto index = internals::find_mismatch(a, b, 0);
+	while(index < count){
+		//	Find the end of this run of differences, one value at a time.
+		auto a_it = a.begin() + index;
+		auto b_it = b.begin() + index;
+		auto end = index;
+		while(end < count && !(*a_it == *b_it)){
+			end++;
+			++a_it;
+			++b_it;
+		}
+		result.push_back(std::make_pair(index, end));
+		index = internals::find_mismatch(a, b, end);
+	}
+
+	if(count < max_count){
+		if(!result.empty() && result.back().second == count){
+			result.back().second = max_count;
+		}
+		else{
+			result.push_back(std::make_pair(count, max_count));
+		}
+	}
+	return result;
+}
+
+
 template <class T> size_t get_inode_count(){
-	return internals::inode<T>::_debug_count;
+	return internals::inode<T, multi_thread>::_debug_count
+		+ internals::inode<T, single_thread>::_debug_count
+		+ internals::inode<T, biased_thread>::_debug_count;
 }
 
 template <class T> size_t get_leaf_count(){
-	return internals::leaf_node<T>::_debug_count;
+	return internals::leaf_node<T, multi_thread>::_debug_count
+		+ internals::leaf_node<T, single_thread>::_debug_count
+		+ internals::leaf_node<T, biased_thread>::_debug_count;
+}
+
+inline std::vector<node_pool_stats> get_node_pool_stats(){
+	std::vector<node_pool_stats> result;
+	for(auto pool = internals::node_pool::get_pools().load() ; pool != nullptr ; pool = pool->_next_pool){
+		result.push_back(pool->get_stats());
+	}
+	return result;
 }
 
 